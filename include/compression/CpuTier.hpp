@@ -0,0 +1,32 @@
+#pragma once
+
+namespace gw2::compression {
+
+// Instruction sets the decoders are compiled for, from the oldest. On other
+// CPUs than x86-64 ones, or with other compilers than GCC and Clang, only
+// kGeneric is available.
+enum class CpuTier {
+  kGeneric,  // x86-64 baseline
+  kAvx2,     // AVX2, BMI1, BMI2, LZCNT
+  kAvx512,   // kAvx2 with AVX-512 F, BW, DQ and VL
+};
+
+// Best tier the CPU supports
+CpuTier detectCpuTier();
+
+/** Tier the decoders use, picked once at the first call: the best supported
+ *  one, or the one named by the environment variable GW2_COMPRESSION_CPU_TIER
+ *  ("generic", "avx2" or "avx512") when it is supported.
+ */
+CpuTier cpuTier();
+
+/** Forces the tier the decoders use, for benchmarking. Calls already running
+ *  keep their tier.
+ *  @Inputs:
+ *    - iTier: Tier to use
+ *  @Return:
+ *    - Tier used from now on, iTier lowered to the best supported one
+ */
+CpuTier setCpuTier(CpuTier iTier);
+
+}  // namespace gw2::compression
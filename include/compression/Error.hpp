@@ -8,6 +8,14 @@ enum class Error {
   kInputBufferIsEmpty,
   kOutputBufferIsEmpty,
   kOutputBufferTooSmall,
+  kUnexpectedEndOfInput,
+  kInvalidHuffmanTree,
+  kInvalidHuffmanCode,
+  kInvalidWriteOffset,
+  kInvalidIndex,
+  kInvalidRange,
+  kChecksumMismatch,
+  kOutputBufferTooLarge,
 };
 
 template <typename T>
@@ -2,13 +2,50 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <vector>
 
 #include "Error.hpp"
+#include "OutputHash.hpp"
 
 namespace gw2::compression {
 
+struct DatFileBufferBatchEntry;
+
+// Thread-safe cache of the Huffman trees built while inflating, for the calls
+// it is passed to. Trees are identified by the code length of each of their
+// symbols. The cache is emptied once it holds iMaxNbTrees trees.
+class DatFileHuffmanTreeCache {
+ public:
+  explicit DatFileHuffmanTreeCache(std::size_t iMaxNbTrees = 1024);
+  ~DatFileHuffmanTreeCache();
+
+  DatFileHuffmanTreeCache(const DatFileHuffmanTreeCache&) = delete;
+  DatFileHuffmanTreeCache& operator=(const DatFileHuffmanTreeCache&) = delete;
+
+  // Number of trees taken from the cache, and built then added to it
+  std::uint64_t nbHits() const;
+  std::uint64_t nbMisses() const;
+
+  void clear();
+
+  struct Impl;
+
+ private:
+  friend Result<std::uint32_t> inflateDatFileBuffer(
+      std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+      DatFileHuffmanTreeCache& ioCache);
+  friend Result<std::uint32_t> inflateDatFileBufferWithSlack(
+      std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+      std::uint32_t iOutputSize, DatFileHuffmanTreeCache& ioCache);
+  friend void inflateDatFileBuffers(
+      std::span<DatFileBufferBatchEntry> ioEntries,
+      DatFileHuffmanTreeCache& ioCache);
+
+  std::unique_ptr<Impl> _pImpl;
+};
+
 /** @Inputs:
  *    - iInputTab: Pointer to the buffer to inflate
  *    - ioOutputTab: Output buffer
@@ -18,4 +55,270 @@ namespace gw2::compression {
 Result<std::uint32_t> inflateDatFileBuffer(std::span<const std::byte> iInputTab,
                                            std::span<std::byte> ioOutputTab);
 
+// Same, taking the Huffman trees from ioCache when possible
+Result<std::uint32_t> inflateDatFileBuffer(std::span<const std::byte> iInputTab,
+                                           std::span<std::byte> ioOutputTab,
+                                           DatFileHuffmanTreeCache& ioCache);
+
+/** Same as inflateDatFileBuffer, the input being given as fragments following
+ *  each other, as read from an archive. They may be split anywhere.
+ *  @Inputs:
+ *    - iInputFragmentTab: Fragments of the buffer to inflate
+ *    - ioOutputTab: Output buffer
+ *  @Return:
+ *    - Actual size of the outputBuffer
+ */
+Result<std::uint32_t> inflateDatFileBuffer(
+    std::span<const std::span<const std::byte>> iInputFragmentTab,
+    std::span<std::byte> ioOutputTab);
+
+/** Same as inflateDatFileBuffer, hashing the output while it is inflated
+ *  rather than in another pass over it once it left the cache.
+ *  @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - ioOutputTab: Output buffer
+ *  @Return:
+ *    - Size of the outputBuffer and hashOutput() of it
+ */
+Result<HashedOutput> inflateDatFileBufferWithHash(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab);
+
+/** Same as inflateDatFileBuffer, checking each word skipped every 64KiB
+ *  against the CRC32C of the bytes since the previous one, or the start of
+ *  the buffer, as the decoding reaches it. A partial last 64KiB has no
+ *  checksum.
+ *  @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - ioOutputTab: Output buffer
+ *  @Return:
+ *    - Actual size of the outputBuffer, Error::kChecksumMismatch when a
+ *      checksum does not match
+ */
+Result<std::uint32_t> inflateDatFileBufferVerified(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab);
+
+/** Same as inflateDatFileBuffer, the output being split in segments
+ *  @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - iOutputSegmentTab: Output buffers, filled one after the other
+ *  @Return:
+ *    - Actual size of the outputBuffer, Error::kOutputBufferTooLarge when the
+ *      segments total more than 4GiB - 1
+ */
+Result<std::uint32_t> inflateDatFileBuffer(
+    std::span<const std::byte> iInputTab,
+    std::span<const std::span<std::byte>> iOutputSegmentTab);
+
+// Writable bytes required after the output by inflateDatFileBufferWithSlack
+inline constexpr std::uint32_t sDatFileOutputSlack = 16;
+
+/** @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - ioOutputTab: Output buffer, at least iOutputSize + sDatFileOutputSlack
+ *                   bytes long. The bytes past iOutputSize are overwritten.
+ *    - iOutputSize: Size of the inflated data
+ *  @Return:
+ *    - Actual size of the outputBuffer
+ */
+Result<std::uint32_t> inflateDatFileBufferWithSlack(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+    std::uint32_t iOutputSize);
+
+// Same, taking the Huffman trees from ioCache when possible
+Result<std::uint32_t> inflateDatFileBufferWithSlack(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+    std::uint32_t iOutputSize, DatFileHuffmanTreeCache& ioCache);
+
+/** Same as inflateDatFileBuffer, the Huffman codes being decoded to literals
+ *  and matches while another thread writes the output from them. Outputs too
+ *  small to benefit from it are inflated directly.
+ *  @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - ioOutputTab: Output buffer
+ *  @Return:
+ *    - Actual size of the outputBuffer
+ */
+Result<std::uint32_t> inflateDatFileBufferPipelined(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab);
+
+// Memory reused by the calls it is passed to, not to be shared by concurrent
+// calls
+class DatFileDecoderContext {
+ public:
+  DatFileDecoderContext();
+  ~DatFileDecoderContext();
+
+  DatFileDecoderContext(const DatFileDecoderContext&) = delete;
+  DatFileDecoderContext& operator=(const DatFileDecoderContext&) = delete;
+
+  struct Impl;
+
+ private:
+  friend Result<std::uint32_t> peekDatFileBuffer(
+      std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+      DatFileDecoderContext& ioContext);
+
+  std::unique_ptr<Impl> _pImpl;
+};
+
+/** Inflates the beginning of a buffer only, stopping as soon as the output
+ *  is full.
+ *  @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - ioOutputTab: Output buffer, as long as the bytes to inflate
+ *    - ioContext: Memory to decode with
+ *  @Return:
+ *    - Bytes inflated, fewer than the size of the output when the buffer is
+ *      shorter
+ */
+Result<std::uint32_t> peekDatFileBuffer(std::span<const std::byte> iInputTab,
+                                        std::span<std::byte> ioOutputTab,
+                                        DatFileDecoderContext& ioContext);
+
+// Sizes of a buffer found by inspectDatFileBuffer
+struct DatFileBufferInfo {
+  // Size of the inflated data
+  std::uint32_t outputSize;
+  // Bytes of the buffer up to the end of its data, framing words included
+  std::size_t inputSize;
+};
+
+/** Inflates a buffer without an output buffer, to check a buffer of known
+ *  size. Only the bytes the next matches can copy from are kept, in a window
+ *  of about 200KiB. Blocks have no end marker, so the size of the inflated
+ *  data cannot be found from the buffer alone.
+ *  @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - iOutputSize: Size of the inflated data
+ *  @Return:
+ *    - Sizes of the buffer
+ */
+Result<DatFileBufferInfo> inspectDatFileBuffer(
+    std::span<const std::byte> iInputTab, std::uint32_t iOutputSize);
+
+// An entry of inflateDatFileBuffers
+struct DatFileBufferBatchEntry {
+  std::span<const std::byte> inputTab;
+  std::span<std::byte> outputTab;
+  // Set as inflateDatFileBuffer(inputTab, outputTab) would return it
+  Result<std::uint32_t> result;
+};
+
+/** Inflates independent buffers, several of them at once on the calling
+ *  thread so that their decoding overlaps. Meant for many small entries.
+ *  @Inputs:
+ *    - ioEntries: Buffers to inflate with their output buffer, receiving
+ *                 their result
+ */
+void inflateDatFileBuffers(std::span<DatFileBufferBatchEntry> ioEntries);
+
+// Same, taking the Huffman trees from ioCache when possible
+void inflateDatFileBuffers(std::span<DatFileBufferBatchEntry> ioEntries,
+                           DatFileHuffmanTreeCache& ioCache);
+
+// Point where inflating a buffer can resume: the start of one of its blocks
+struct DatFileCheckpoint {
+  // Bits of the input read before the block, framing words excluded
+  std::uint64_t inputBitPos;
+  std::uint32_t outputPos;
+  // Inflated bytes before outputPos that the block can copy from, 128KiB at
+  // most
+  std::vector<std::byte> windowTab;
+};
+
+// Checkpoints of a buffer, by increasing output position
+struct DatFileIndex {
+  std::uint32_t outputSize{0};
+  std::vector<DatFileCheckpoint> checkpoints;
+};
+
+// Default inflated bytes between two checkpoints
+inline constexpr std::uint32_t sDatFileDefaultCheckpointInterval = 1 << 20;
+
+/** Same as inflateDatFileBuffer, recording a checkpoint at the first block
+ *  then at the first block starting iCheckpointInterval bytes after the last
+ *  checkpoint.
+ *  @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - ioOutputTab: Output buffer
+ *    - oIndex: Receives the checkpoints
+ *    - iCheckpointInterval: Inflated bytes between two checkpoints at least
+ *  @Return:
+ *    - Actual size of the outputBuffer
+ */
+Result<std::uint32_t> inflateDatFileBuffer(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+    DatFileIndex& oIndex,
+    std::uint32_t iCheckpointInterval = sDatFileDefaultCheckpointInterval);
+
+// Stores an index in a buffer, to be kept alongside the inflated one
+std::vector<std::byte> serializeDatFileIndex(const DatFileIndex& iIndex);
+
+// Reads an index stored by serializeDatFileIndex
+Result<DatFileIndex> deserializeDatFileIndex(
+    std::span<const std::byte> iIndexTab);
+
+/** Inflates a range of a buffer only, from the last checkpoint before it.
+ *  @Inputs:
+ *    - iInputTab: Pointer to the buffer to inflate
+ *    - iIndex: Checkpoints of the buffer
+ *    - iRangePos: Position of the range in the inflated data
+ *    - ioOutputTab: Output buffer, as long as the range
+ *  @Return:
+ *    - Bytes of the range inflated, fewer than its size when the buffer ends
+ *      before it
+ */
+Result<std::uint32_t> inflateDatFileRange(std::span<const std::byte> iInputTab,
+                                          const DatFileIndex& iIndex,
+                                          std::uint32_t iRangePos,
+                                          std::span<std::byte> ioOutputTab);
+
+// Inflates a buffer given in successive parts, keeping in memory only the
+// inflated bytes that the next ones can copy from. The input is read in place,
+// only the few bytes a call cannot decode without the following ones are
+// kept. The 64KiB framing of the buffer may be split anywhere.
+class DatInflater {
+ public:
+  // iOutputSize: Size of the inflated data
+  explicit DatInflater(std::uint32_t iOutputSize);
+  ~DatInflater();
+
+  DatInflater(const DatInflater&) = delete;
+  DatInflater& operator=(const DatInflater&) = delete;
+
+  /** @Inputs:
+   *    - iInputTab: Next bytes of the buffer to inflate, starting with the
+   *      ones the previous call did not consume, possibly none
+   *    - iIsLastInput: Whether they end the buffer
+   *  @Return:
+   *    - Bytes inflated by this call, valid until the next one. A call stops
+   *      when its input runs out, once it inflated sMaxOutputSize bytes or
+   *      once it went through sMaxInputSize bytes of input.
+   *      Errors are returned again by the next calls.
+   */
+  Result<std::span<const std::byte>> inflate(
+      std::span<const std::byte> iInputTab, bool iIsLastInput);
+
+  // Most bytes returned by a call to inflate()
+  static constexpr std::uint32_t sMaxOutputSize = 1 << 16;
+
+  // Most input bytes gone through by a call to inflate()
+  static constexpr std::size_t sMaxInputSize = 1 << 20;
+
+  // Whether the last call to inflate() stopped for lack of input, all of it
+  // being consumed
+  bool needsInput() const;
+
+  // Bytes of its input consumed by the last call to inflate()
+  std::size_t nbConsumedInputBytes() const;
+
+  // Whether the whole buffer was inflated and returned
+  bool isDone() const;
+
+  struct Impl;
+
+ private:
+  std::unique_ptr<Impl> _pImpl;
+};
+
 }  // namespace gw2::compression
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <span>
 
 #include "Error.hpp"
+#include "OutputHash.hpp"
 
 namespace gw2::compression {
 
@@ -21,4 +22,32 @@ Result<std::uint32_t> inflateTextureBlockBuffer(
     std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
     std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab);
 
+/** Same, the buffer to inflate being given as fragments following each
+ *  other, split anywhere
+ */
+Result<std::uint32_t> inflateTextureBlockBuffer(
+    std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
+    std::span<const std::span<const std::byte>> iInputFragmentTab,
+    std::span<std::byte> ioOutputTab);
+
+/** Same, checking each word skipped every 64KiB against the CRC32C of the
+ *  bytes since the previous one, or the start of the buffer, as the decoding
+ *  reaches it
+ *  @Return:
+ *    - Actual size of the outputBuffer, Error::kChecksumMismatch when a
+ *      checksum does not match
+ */
+Result<std::uint32_t> inflateTextureBlockBufferVerified(
+    std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab);
+
+/** Same, hashing the output right after it is inflated, while it is still in
+ *  cache
+ *  @Return:
+ *    - Actual size of the outputBuffer and hashOutput() of it
+ */
+Result<HashedOutput> inflateTextureBlockBufferWithHash(
+    std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab);
+
 }  // namespace gw2::compression
\ No newline at end of file
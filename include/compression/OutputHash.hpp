@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace gw2::compression {
+
+// Returned by the inflating functions computing a hash of their output
+struct HashedOutput {
+  // Size of the inflated data
+  std::uint32_t outputSize;
+  // hashOutput() of the inflated data
+  std::uint64_t hash;
+};
+
+/** Non-cryptographic hash, XXH64 with a zero seed.
+ *  @Inputs:
+ *    - iBufferTab: Bytes to hash
+ *  @Return:
+ *    - Hash of the bytes
+ */
+std::uint64_t hashOutput(std::span<const std::byte> iBufferTab);
+
+}  // namespace gw2::compression
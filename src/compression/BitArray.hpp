@@ -1,29 +1,217 @@
 #pragma once
 
+#include <algorithm>
 #include <bit>
 #include <cassert>
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <span>
+
+#include "Crc32c.hpp"
 
 namespace gw2::utils {
 
-template <std::integral IntType>
+// Skip policies, giving in words the position of the first skipped word and
+// the distance between two skipped words
+struct NoSkipPolicy {
+  static constexpr std::size_t sFirstSkippedWord =
+      std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t sSkippedWordPeriod =
+      std::numeric_limits<std::size_t>::max();
+};
+
+template <std::size_t sNbWords, std::size_t sFirstWord = sNbWords - 1>
+struct EveryNWordsSkipPolicy {
+  static_assert(sNbWords > 1, "At least one word must be read between skips.");
+  static_assert(sFirstWord > 0, "The first word cannot be skipped.");
+
+  static constexpr std::size_t sFirstSkippedWord = sFirstWord;
+  static constexpr std::size_t sSkippedWordPeriod = sNbWords;
+};
+
+// Reads a stream of little endian IntType words, most significant bits first.
+//
+// The bits are kept left aligned in a 64 bits buffer. refill() appends whole
+// words to it until more than sMinBitsAfterRefill - 1 bits are available, with
+// a single unaligned load away from the skipped words and the end of the
+// buffer. Decoding loops can then peek() and consume() any number of fields
+// totalling at most sMinBitsAfterRefill bits without further checks.
+//
+// The words selected by SkipPolicy are not part of the stream. The position of
+// the next one is kept as a pointer, bounding the single load refills.
+//
+// The buffer may be given as fragments following each other, split anywhere.
+// Only the current one is read by the single load refills, the words around
+// the end of a fragment are put together byte by byte. Positions are counted
+// from the start of the whole buffer.
+//
+// A trailing partial word is ignored. Past the end of the buffer, zero bits are
+// served so that decoding loops do not
+// have to check for it, readPastEnd() tells whether any of them was consumed.
+// Decoders reading invalid data flag it with markCorrupted() and keep going.
+//
+// With iVerifiesChecksums, each skipped word is compared as it is crossed with
+// the CRC32C of the bytes between it and the previous one, or the start of the
+// buffer. The bytes are added to the CRC when leaving their fragment or
+// reaching the skipped word, away from the single load refills.
+//
+// read() and drop() keep the original semantics: drop() refills, so that at
+// least sizeof(IntType) * 8 bits can always be read.
+template <std::integral IntType, typename SkipPolicy = NoSkipPolicy>
 class BitArray {
  public:
-  BitArray(std::span<const std::byte> ipBuffer, std::uint32_t iSkippedBytes = 0)
-      : _pBufferStartPos(ipBuffer.data()),
-        _pBufferPos(ipBuffer.data()),
-        _bytesAvail(ipBuffer.size()),
-        _skippedBytes(iSkippedBytes),
-        _head(0),
-        _buffer(0),
-        _bitsAvail(0) {
-    assert(ipBuffer.size() % sizeof(IntType) == 0);
+  static_assert(sizeof(IntType) == sizeof(std::uint32_t),
+                "Only 32 bits words are supported.");
+
+  static constexpr std::uint8_t sMinBitsAfterRefill = sizeof(IntType) * 8 + 1;
+
+  using FragmentTab = std::span<const std::span<const std::byte>>;
+
+  BitArray(std::span<const std::byte> ipBuffer, bool iVerifiesChecksums = false)
+      : _singleFragment(ipBuffer),
+        _bufferSize(ipBuffer.size() / sizeof(IntType) * sizeof(IntType)),
+        _isVerifyingChecksums(iVerifiesChecksums) {
+    enterFragment(0, 0);
+    refill();
+  }
+
+  explicit BitArray(FragmentTab iFragmentTab, bool iVerifiesChecksums = false)
+      : _fragmentTab(iFragmentTab), _isVerifyingChecksums(iVerifiesChecksums) {
+    for (std::span<const std::byte> aFragment : iFragmentTab) {
+      _bufferSize += aFragment.size();
+    }
+    _bufferSize = _bufferSize / sizeof(IntType) * sizeof(IntType);
+    enterFragment(0, 0);
+    refill();
+  }
+
+  void refill() {
+    if (std::distance(_pBufferPos, _pNextSkippedPos) >=
+        static_cast<std::ptrdiff_t>(sizeof(std::uint64_t))) [[likely]] {
+      std::uint64_t aValue;
+      std::memcpy(&aValue, _pBufferPos, sizeof(aValue));
+      aValue = std::rotl(aValue, sizeof(IntType) * 8);
+
+      // Only the words fitting entirely are accounted for, the bits appended
+      // after them are the right ones and will be appended again
+      _bitBuffer |= _bitsAvail < 64 ? (aValue >> _bitsAvail) : 0;
+      std::uint8_t aNbWords = (64 - _bitsAvail) / (sizeof(IntType) * 8);
+      _pBufferPos += aNbWords * sizeof(IntType);
+      _bitsAvail += aNbWords * sizeof(IntType) * 8;
+    } else {
+      refillSlow();
+    }
+  }
+
+  std::uint64_t peek(std::uint8_t iBitNumber) const {
+    assert(iBitNumber > 0 && iBitNumber <= 64 &&
+           "Invalid number of bits requested.");
+    return _bitBuffer >> (64 - iBitNumber);
+  }
+
+  template <std::uint8_t isBitNumber>
+  std::uint64_t peek() const {
+    static_assert(isBitNumber > 0 && isBitNumber <= 64,
+                  "isBitNumber must be in [1, 64].");
+    return _bitBuffer >> (64 - isBitNumber);
+  }
+
+  // peek() also accepting 0 bits, for fields of variable length
+  std::uint64_t peekVariable(std::uint8_t iBitNumber) const {
+    assert(iBitNumber < 64 && "Invalid number of bits requested.");
+    return (_bitBuffer >> 1) >> (63 - iBitNumber);
+  }
+
+  void consume(std::uint8_t iBitNumber) {
+    assert(iBitNumber < 64 && "Invalid number of bits to be consumed.");
+    assert(_bitsAvail >= iBitNumber &&
+           "Too much bits were asked to be consumed.");
+    _bitBuffer <<= iBitNumber;
+    _bitsAvail -= iBitNumber;
+  }
+
+  bool readPastEnd() const { return _nbPaddingBits > _bitsAvail; }
+
+  // Whether zero bits were appended past the end of the buffer
+  bool reachedEnd() const { return _nbPaddingBits != 0; }
+
+  // Bits of the buffer left to consume, skipped words included
+  std::size_t nbBitsLeft() const {
+    std::size_t aNbBufferedBits =
+        _bitsAvail - std::min<std::uint64_t>(_nbPaddingBits, _bitsAvail);
+    return (_bufferSize - bufferPos()) * 8 + aNbBufferedBits;
+  }
+
+  // Bits of the stream consumed, skipped words excluded
+  std::size_t nbConsumedBits() const {
+    std::size_t aNbWords = bufferPos() / sizeof(IntType);
+    aNbWords -= nbSkippedWordsBefore(aNbWords);
+    std::size_t aNbBufferedBits =
+        _bitsAvail - std::min<std::uint64_t>(_nbPaddingBits, _bitsAvail);
+    return aNbWords * sizeof(IntType) * 8 - aNbBufferedBits;
+  }
+
+  // Bytes of the buffer up to the last consumed bit, skipped words included
+  std::size_t nbConsumedBytes() const {
+    std::size_t aNbWords = (nbConsumedBits() + sizeof(IntType) * 8 - 1) /
+                           (sizeof(IntType) * 8);
+    return aNbWords == 0 ? 0 : (bufferWordPos(aNbWords - 1) + 1) *
+                                   sizeof(IntType);
+  }
+
+  // Position in the buffer of a word of the stream
+  static std::size_t bufferWordPos(std::size_t iWordPos) {
+    if (iWordPos < SkipPolicy::sFirstSkippedWord) {
+      return iWordPos;
+    }
+    return iWordPos +
+           (iWordPos - SkipPolicy::sFirstSkippedWord) /
+               (SkipPolicy::sSkippedWordPeriod - 1) +
+           1;
+  }
+
+  // Moves to the bit of the stream following iNbBits consumed bits, the
+  // corrupted flag is kept. The checksums are not verified anymore.
+  void seek(std::size_t iNbBits) {
+    constexpr std::size_t sFirstSkippedWord = SkipPolicy::sFirstSkippedWord;
+    constexpr std::size_t sSkippedWordPeriod = SkipPolicy::sSkippedWordPeriod;
+
+    // Position in the buffer of the word holding the bit, and of the next
+    // skipped word
+    std::size_t aWordPos = bufferWordPos(iNbBits / (sizeof(IntType) * 8));
+    std::size_t aSkippedWordPos = sFirstSkippedWord;
+    if (aWordPos > sFirstSkippedWord) {
+      aSkippedWordPos +=
+          (aWordPos - sFirstSkippedWord + sSkippedWordPeriod - 1) /
+          sSkippedWordPeriod * sSkippedWordPeriod;
+    }
 
-    pull(_head, _bitsAvail);
+    const std::size_t aPos = std::min(aWordPos * sizeof(IntType), _bufferSize);
+    _isVerifyingChecksums = false;
+    _nextSkippedWordPos = aSkippedWordPos;
+    enterFragment(0, 0);
+    while (aPos > _fragmentPos + std::distance(_pBufferStartPos,
+                                               _pBufferEndPos)) {
+      nextFragment();
+    }
+    _pBufferPos = _pBufferStartPos + (aPos - _fragmentPos);
+    _bitBuffer = 0;
+    _bitsAvail = 0;
+    _nbPaddingBits = 0;
+    refill();
+    consume(iNbBits % (sizeof(IntType) * 8));
   }
 
+  void markCorrupted() { _isCorrupted = true; }
+  bool isCorrupted() const { return _isCorrupted; }
+
+  // Whether a skipped word crossed so far did not match its checksum
+  bool hasChecksumMismatch() const { return _hasChecksumMismatch; }
+
   void readLazy(std::uint8_t iBitNumber, std::integral auto& oValue) const {
     assert((iBitNumber <= sizeof(oValue) * 8) &&
            "Invalid number of bits requested.");
@@ -87,79 +275,177 @@ class BitArray {
 
  private:
   void readImpl(std::uint8_t iBitNumber, std::integral auto& oValue) const {
-    oValue = (_head >> ((sizeof(IntType) * 8) - iBitNumber));
+    oValue = (_bitBuffer >> (64 - iBitNumber));
   }
 
   void dropImpl(std::uint8_t iBitNumber) {
     assert(_bitsAvail >= iBitNumber &&
            "Too much bits were asked to be dropped.");
+    consume(iBitNumber);
+    refill();
+  }
 
-    std::uint8_t aNewBitsAvail = _bitsAvail - iBitNumber;
-    if (aNewBitsAvail >= sizeof(IntType) * 8) {
-      if (iBitNumber == sizeof(IntType) * 8) {
-        _head = _buffer;
-        _buffer = 0;
-      } else {
-        _head = (_head << iBitNumber) |
-                (_buffer >> ((sizeof(IntType) * 8) - iBitNumber));
-        _buffer = _buffer << iBitNumber;
-      }
-      _bitsAvail = aNewBitsAvail;
-    } else {
+  // Number of skipped words among the first iNbWords words of the buffer
+  static std::size_t nbSkippedWordsBefore(std::size_t iNbWords) {
+    if (iNbWords <= SkipPolicy::sFirstSkippedWord) {
+      return 0;
+    }
+    return (iNbWords - SkipPolicy::sFirstSkippedWord - 1) /
+               SkipPolicy::sSkippedWordPeriod +
+           1;
+  }
+
+  // Word by word refill, used around the skipped words and the end of the
+  // buffer
+  [[gnu::noinline]] void refillSlow() {
+    while (_bitsAvail <= sizeof(IntType) * 8) {
       IntType aNewValue;
       std::uint8_t aNbPulledBits;
       pull(aNewValue, aNbPulledBits);
-
-      if (iBitNumber == sizeof(IntType) * 8) {
-        _head = 0;
-      } else {
-        _head = _head << iBitNumber;
+      if (aNbPulledBits == 0) {
+        // Serving the zero bits following the available ones
+        _nbPaddingBits += 64 - _bitsAvail;
+        _bitsAvail = 64;
+        break;
       }
-      _head |= (_buffer >> ((sizeof(IntType) * 8) - iBitNumber)) |
-               (aNewValue >> (aNewBitsAvail));
-      if (aNewBitsAvail > 0) {
-        _buffer = aNewValue << ((sizeof(IntType) * 8) - aNewBitsAvail);
+
+      _bitBuffer |= static_cast<std::uint64_t>(aNewValue)
+                    << (64 - aNbPulledBits - _bitsAvail);
+      _bitsAvail += aNbPulledBits;
+    }
+  }
+
+  // Position in the buffer of the next byte to pull
+  std::size_t bufferPos() const {
+    return _fragmentPos + std::distance(_pBufferStartPos, _pBufferPos);
+  }
+
+  // Makes the fragment iFragmentIndex, starting at iFragmentPos in the
+  // buffer, the current one. Its bytes past the last whole word are ignored.
+  void enterFragment(std::size_t iFragmentIndex, std::size_t iFragmentPos) {
+    std::span<const std::byte> aFragment =
+        _fragmentTab.empty() ? _singleFragment : _fragmentTab[iFragmentIndex];
+    _fragmentIndex = iFragmentIndex;
+    _fragmentPos = iFragmentPos;
+    _pBufferStartPos = aFragment.data();
+    _pBufferPos = aFragment.data();
+    _pBufferEndPos =
+        aFragment.data() +
+        std::min(aFragment.size(), _bufferSize - std::min(iFragmentPos,
+                                                          _bufferSize));
+    updateNextSkippedPos();
+  }
+
+  void nextFragment() {
+    if (_isVerifyingChecksums) {
+      updateChecksum();
+    }
+    enterFragment(_fragmentIndex + 1,
+                  _fragmentPos + std::distance(_pBufferStartPos,
+                                               _pBufferEndPos));
+  }
+
+  // Points _pNextSkippedPos at the next skipped word, or at the end of the
+  // current fragment when it is not in it
+  void updateNextSkippedPos() {
+    const std::size_t aFragmentEndPos =
+        _fragmentPos + std::distance(_pBufferStartPos, _pBufferEndPos);
+    if (_nextSkippedWordPos >= aFragmentEndPos / sizeof(IntType)) {
+      _pNextSkippedPos = _pBufferEndPos;
+    } else {
+      _pNextSkippedPos = _pBufferStartPos +
+                         (_nextSkippedWordPos * sizeof(IntType) - _fragmentPos);
+    }
+  }
+
+  // Adds to the checksum the bytes of the current fragment pulled since the
+  // last update, up to the next skipped word
+  void updateChecksum() {
+    const std::size_t anEndPos =
+        _nextSkippedWordPos < _bufferSize / sizeof(IntType)
+            ? std::min(bufferPos(), _nextSkippedWordPos * sizeof(IntType))
+            : bufferPos();
+    if (anEndPos > _checksumPos) {
+      _checksum =
+          crc32c(_checksum, {_pBufferStartPos + (_checksumPos - _fragmentPos),
+                             anEndPos - _checksumPos});
+      _checksumPos = anEndPos;
+    }
+  }
+
+  // Copies the next bytes, across fragments, bufferPos() + iSize not being
+  // past the end of the buffer
+  void pullBytes(std::byte* oBytes, std::size_t iSize) {
+    while (iSize != 0) {
+      if (_pBufferPos == _pBufferEndPos) {
+        nextFragment();
+        continue;
       }
-      _bitsAvail = aNewBitsAvail + aNbPulledBits;
+      const std::size_t aSize = std::min<std::size_t>(
+          iSize, std::distance(_pBufferPos, _pBufferEndPos));
+      std::memcpy(oBytes, _pBufferPos, aSize);
+      _pBufferPos += aSize;
+      oBytes += aSize;
+      iSize -= aSize;
     }
   }
 
   void pull(IntType& oValue, std::uint8_t& oNbPulledBits) {
-    if (_bytesAvail >= sizeof(IntType)) {
-      if (_skippedBytes != 0) {
-        if (_skippedBytes == 0xffff) {
-          auto distance = std::distance(_pBufferStartPos, _pBufferPos);
-          if (distance > 0 && ((distance + 12) % 0x10000 == 0)) {
-            _bytesAvail -= sizeof(IntType);
-            _pBufferPos += sizeof(IntType);
-          }
-        } else if (_pBufferPos != _pBufferStartPos &&
-                   (((_pBufferPos - _pBufferStartPos) / sizeof(IntType)) + 1) %
-                           _skippedBytes ==
-                       0) {
-          _bytesAvail -= sizeof(IntType);
-          _pBufferPos += sizeof(IntType);
+    if ((bufferPos() / sizeof(IntType) == _nextSkippedWordPos) &&
+        (bufferPos() != _bufferSize)) {
+      if (_isVerifyingChecksums) {
+        updateChecksum();
+      }
+      IntType aSkippedValue;
+      pullBytes(reinterpret_cast<std::byte*>(&aSkippedValue),
+                sizeof(IntType));
+      _nextSkippedWordPos += SkipPolicy::sSkippedWordPeriod;
+      if (_isVerifyingChecksums) {
+        if (aSkippedValue != _checksum) {
+          _hasChecksumMismatch = true;
         }
+        _checksum = 0;
+        _checksumPos = bufferPos();
       }
-      oValue = *(std::bit_cast<const IntType*>(_pBufferPos));
-      _bytesAvail -= sizeof(IntType);
-      _pBufferPos += sizeof(IntType);
+    }
+    if (bufferPos() != _bufferSize) {
+      pullBytes(reinterpret_cast<std::byte*>(&oValue), sizeof(IntType));
       oNbPulledBits = sizeof(IntType) * 8;
     } else {
       oValue = 0;
       oNbPulledBits = 0;
     }
+    updateNextSkippedPos();
   }
 
-  const std::byte* const _pBufferStartPos;
-  const std::byte* _pBufferPos;
-  std::uint32_t _bytesAvail;
+  // Fragments of the buffer, _singleFragment when it is not fragmented
+  FragmentTab _fragmentTab;
+  std::span<const std::byte> _singleFragment;
+  std::size_t _bufferSize{0};
+
+  // Current fragment, starting at _fragmentPos in the buffer
+  std::size_t _fragmentIndex{0};
+  std::size_t _fragmentPos{0};
+  const std::byte* _pBufferStartPos{nullptr};
+  const std::byte* _pBufferPos{nullptr};
+  const std::byte* _pBufferEndPos{nullptr};
+
+  std::size_t _nextSkippedWordPos{SkipPolicy::sFirstSkippedWord};
+  const std::byte* _pNextSkippedPos{nullptr};
+
+  std::uint64_t _bitBuffer{0};
+  std::uint8_t _bitsAvail{0};
 
-  std::uint32_t _skippedBytes;
+  // Zero bits appended past the end of the buffer, all of them are still in
+  // _bitBuffer as long as there are less than _bitsAvail
+  std::uint64_t _nbPaddingBits{0};
+  bool _isCorrupted{false};
 
-  IntType _head;
-  IntType _buffer;
-  std::uint8_t _bitsAvail;
+  // CRC32C of the bytes from the last skipped word to _checksumPos
+  bool _isVerifyingChecksums{false};
+  bool _hasChecksumMismatch{false};
+  std::uint32_t _checksum{0};
+  std::size_t _checksumPos{0};
 };
 
-}  // namespace gw2::utils
\ No newline at end of file
+}  // namespace gw2::utils
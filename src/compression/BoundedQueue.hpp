@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace gw2::utils {
+
+// Thread-safe FIFO holding at most sCapacity elements. push() waits for room,
+// pop() waits for an element until the queue is closed.
+template <typename T, std::size_t sCapacity>
+class BoundedQueue {
+ public:
+  static_assert(sCapacity > 0, "Invalid queue capacity.");
+
+  // Returns false, dropping iElement, when the queue is closed
+  bool push(T iElement) {
+    std::unique_lock aLock(_mutex);
+    _notFullCondition.wait(
+        aLock, [this] { return _closed || _elements.size() < sCapacity; });
+    if (_closed) {
+      return false;
+    }
+    _elements.push_back(std::move(iElement));
+    aLock.unlock();
+    _notEmptyCondition.notify_one();
+    return true;
+  }
+
+  // Returns std::nullopt once the queue is closed and empty
+  std::optional<T> pop() {
+    std::unique_lock aLock(_mutex);
+    _notEmptyCondition.wait(aLock,
+                            [this] { return _closed || !_elements.empty(); });
+    return popLocked(aLock);
+  }
+
+  // Returns std::nullopt when the queue is empty
+  std::optional<T> tryPop() {
+    std::unique_lock aLock(_mutex);
+    return popLocked(aLock);
+  }
+
+  // Wakes up the waiting threads, the elements left can still be popped
+  void close() {
+    {
+      std::lock_guard aLock(_mutex);
+      _closed = true;
+    }
+    _notFullCondition.notify_all();
+    _notEmptyCondition.notify_all();
+  }
+
+ private:
+  std::optional<T> popLocked(std::unique_lock<std::mutex>& ioLock) {
+    if (_elements.empty()) {
+      return std::nullopt;
+    }
+    std::optional<T> anElement{std::move(_elements.front())};
+    _elements.pop_front();
+    ioLock.unlock();
+    _notFullCondition.notify_one();
+    return anElement;
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _notFullCondition;
+  std::condition_variable _notEmptyCondition;
+  std::deque<T> _elements;
+  bool _closed{false};
+};
+
+}  // namespace gw2::utils
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace gw2::utils {
+
+// Width of the chunks written by copyMatch()
+static constexpr std::uint32_t sCopyMatchChunkSize = 16;
+
+// copyMatch() may write up to this number of bytes past the copied ones
+static constexpr std::uint32_t sCopyMatchMaxOverrun = sCopyMatchChunkSize - 1;
+
+// Copies iSize bytes from iOffset bytes before ioDestination, the two ranges
+// overlapping when iOffset < iSize, by chunks of sCopyMatchChunkSize bytes.
+// Offsets shorter than a chunk repeat a chunk wide pattern of their period.
+inline void copyMatch(std::byte* ioDestination, std::uint32_t iOffset,
+                      std::uint32_t iSize) {
+  assert(iOffset > 0 && "Invalid copy offset.");
+
+  const std::byte* pSource = ioDestination - iOffset;
+  std::byte* const pDestinationEnd = ioDestination + iSize;
+
+  if (iOffset >= sCopyMatchChunkSize) [[likely]] {
+    while (ioDestination < pDestinationEnd) {
+      std::memcpy(ioDestination, pSource, sCopyMatchChunkSize);
+      ioDestination += sCopyMatchChunkSize;
+      pSource += sCopyMatchChunkSize;
+    }
+    return;
+  }
+
+  // Largest multiple of the period fitting in a chunk, so that every chunk
+  // starts at the same phase of the pattern
+  constexpr auto sPatternStepArray = [] {
+    std::array<std::uint8_t, sCopyMatchChunkSize> aStepArray{};
+    for (std::uint32_t aPeriod = 1; aPeriod < sCopyMatchChunkSize; ++aPeriod) {
+      aStepArray[aPeriod] = sCopyMatchChunkSize - sCopyMatchChunkSize % aPeriod;
+    }
+    return aStepArray;
+  }();
+
+  std::array<std::byte, sCopyMatchChunkSize> aPattern;
+  std::memcpy(aPattern.data(), pSource, iOffset);
+  for (std::uint32_t i = iOffset; i < sCopyMatchChunkSize; ++i) {
+    aPattern[i] = aPattern[i - iOffset];
+  }
+
+  const std::uint8_t aStep = sPatternStepArray[iOffset];
+  while (ioDestination < pDestinationEnd) {
+    std::memcpy(ioDestination, aPattern.data(), sCopyMatchChunkSize);
+    ioDestination += aStep;
+  }
+}
+
+}  // namespace gw2::utils
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "compression/CpuTier.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GW2_COMPRESSION_HAS_CPU_TIERS
+#endif
+
+namespace gw2::utils {
+
+// A kernel is compiled once per tier by calling it from a function compiled
+// for the instruction sets of the tier, into which everything it calls is
+// inlined. Each kernel being a distinct lambda, each gets its own functions.
+#ifdef GW2_COMPRESSION_HAS_CPU_TIERS
+template <typename KernelType>
+__attribute__((target("avx2,bmi,bmi2,lzcnt,popcnt,fma"), flatten)) auto
+callKernelAvx2(const KernelType& iKernel) {
+  return iKernel();
+}
+
+template <typename KernelType>
+__attribute__((target("avx2,bmi,bmi2,lzcnt,popcnt,fma,avx512f,avx512bw,"
+                      "avx512dq,avx512vl"),
+               flatten)) auto
+callKernelAvx512(const KernelType& iKernel) {
+  return iKernel();
+}
+#endif
+
+// Calls iKernel compiled for compression::cpuTier()
+template <typename KernelType>
+auto callKernel(const KernelType& iKernel) {
+#ifdef GW2_COMPRESSION_HAS_CPU_TIERS
+  switch (compression::cpuTier()) {
+    case compression::CpuTier::kAvx512:
+      return callKernelAvx512(iKernel);
+    case compression::CpuTier::kAvx2:
+      return callKernelAvx2(iKernel);
+    case compression::CpuTier::kGeneric:
+      break;
+  }
+#endif
+  return iKernel();
+}
+
+}  // namespace gw2::utils
@@ -0,0 +1,69 @@
+#include "compression/CpuTier.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <string_view>
+
+#include "CpuDispatch.hpp"
+
+namespace gw2::compression {
+
+namespace {
+
+CpuTier readCpuTier() {
+  const CpuTier aDetectedTier = detectCpuTier();
+
+  const char* pName = std::getenv("GW2_COMPRESSION_CPU_TIER");
+  if (pName == nullptr) {
+    return aDetectedTier;
+  }
+  const std::string_view aName(pName);
+  CpuTier aTier = aDetectedTier;
+  if (aName == "generic") {
+    aTier = CpuTier::kGeneric;
+  } else if (aName == "avx2") {
+    aTier = CpuTier::kAvx2;
+  } else if (aName == "avx512") {
+    aTier = CpuTier::kAvx512;
+  }
+  return std::min(aTier, aDetectedTier);
+}
+
+std::atomic<CpuTier>& currentCpuTier() {
+  static std::atomic<CpuTier> sCpuTier{readCpuTier()};
+  return sCpuTier;
+}
+
+}  // namespace
+
+CpuTier detectCpuTier() {
+#ifdef GW2_COMPRESSION_HAS_CPU_TIERS
+  __builtin_cpu_init();
+  const bool aHasAvx2 =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") &&
+      __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("lzcnt") &&
+      __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("fma");
+  const bool aHasAvx512 =
+      aHasAvx2 && __builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+  if (aHasAvx512) {
+    return CpuTier::kAvx512;
+  }
+  if (aHasAvx2) {
+    return CpuTier::kAvx2;
+  }
+#endif
+  return CpuTier::kGeneric;
+}
+
+CpuTier cpuTier() { return currentCpuTier().load(std::memory_order_relaxed); }
+
+CpuTier setCpuTier(CpuTier iTier) {
+  const CpuTier aTier = std::min(iTier, detectCpuTier());
+  currentCpuTier().store(aTier, std::memory_order_relaxed);
+  return aTier;
+}
+
+}  // namespace gw2::compression
@@ -0,0 +1,72 @@
+#include "Crc32c.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define GW2_COMPRESSION_HAS_SSE42_CRC32C
+#endif
+
+namespace gw2::utils {
+
+namespace {
+
+// Reflected polynomial
+static constexpr std::uint32_t sCrc32cPolynomial = 0x82f63b78;
+
+static constexpr auto sCrc32cTable = [] {
+  std::array<std::uint32_t, 256> aTable{};
+  for (std::uint32_t aByte = 0; aByte < aTable.size(); ++aByte) {
+    std::uint32_t aCrc = aByte;
+    for (int aBit = 0; aBit < 8; ++aBit) {
+      aCrc = (aCrc >> 1) ^ ((aCrc & 1) ? sCrc32cPolynomial : 0);
+    }
+    aTable[aByte] = aCrc;
+  }
+  return aTable;
+}();
+
+std::uint32_t crc32cSoftware(std::uint32_t iCrc,
+                             std::span<const std::byte> iBytes) {
+  std::uint32_t aCrc = ~iCrc;
+  for (std::byte aByte : iBytes) {
+    aCrc = (aCrc >> 8) ^
+           sCrc32cTable[(aCrc ^ std::to_integer<std::uint32_t>(aByte)) & 0xff];
+  }
+  return ~aCrc;
+}
+
+#ifdef GW2_COMPRESSION_HAS_SSE42_CRC32C
+__attribute__((target("sse4.2"))) std::uint32_t crc32cSse42(
+    std::uint32_t iCrc, std::span<const std::byte> iBytes) {
+  std::uint64_t aCrc = ~iCrc;
+  const std::byte* pBytes = iBytes.data();
+  std::size_t aNbBytes = iBytes.size();
+  for (; aNbBytes >= sizeof(std::uint64_t);
+       aNbBytes -= sizeof(std::uint64_t), pBytes += sizeof(std::uint64_t)) {
+    std::uint64_t aValue;
+    std::memcpy(&aValue, pBytes, sizeof(aValue));
+    aCrc = _mm_crc32_u64(aCrc, aValue);
+  }
+  std::uint32_t aCrc32 = static_cast<std::uint32_t>(aCrc);
+  for (; aNbBytes != 0; --aNbBytes, ++pBytes) {
+    aCrc32 = _mm_crc32_u8(aCrc32, std::to_integer<std::uint8_t>(*pBytes));
+  }
+  return ~aCrc32;
+}
+#endif
+
+}  // namespace
+
+std::uint32_t crc32c(std::uint32_t iCrc, std::span<const std::byte> iBytes) {
+#ifdef GW2_COMPRESSION_HAS_SSE42_CRC32C
+  static const bool sHasSse42 = __builtin_cpu_supports("sse4.2");
+  if (sHasSse42) {
+    return crc32cSse42(iCrc, iBytes);
+  }
+#endif
+  return crc32cSoftware(iCrc, iBytes);
+}
+
+}  // namespace gw2::utils
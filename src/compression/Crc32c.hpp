@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace gw2::utils {
+
+// CRC32C (Castagnoli) of the bytes iCrc is the CRC of followed by iBytes, the
+// CRC of no bytes being 0. Uses the SSE4.2 crc32 instruction when the CPU has
+// it.
+std::uint32_t crc32c(std::uint32_t iCrc, std::span<const std::byte> iBytes);
+
+}  // namespace gw2::utils
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 #include "BitArray.hpp"
 
@@ -13,49 +17,155 @@ template <std::integral SymbolType, std::uint8_t sMaxCodeBitsLength,
 class HuffmanTreeBuilder;
 
 // Assumption: code length <= 32
+//
+// Codes are decoded through a packed lookup table indexed by the next
+// _nbBitsHash bits of the stream (at most sNbBitsHash, chosen per tree from its
+// longest code). Each entry holds the symbol and its code length, or the
+// location of a second level table resolving the codes sharing this prefix.
+// Codes that do not fit in the second level tables are found by scanning
+// _codeComparisonArray.
+//
+// When sNbLiteralSymbols is not 0, symbols below it are literals and a second
+// table indexed like the lookup table gives the run of up to sMaxNbLiterals
+// literals whose codes fit together in the _nbBitsHash next bits.
+//
+// Trees and builders can be built in constant expressions once value
+// initialized. Default initialized ones are left uninitialized, building a tree
+// overwrites everything it reads.
 template <std::integral SymbolType, std::uint8_t sNbBitsHash,
-          std::uint8_t sMaxCodeBitsLength, std::uint16_t sMaxSymbolValue>
+          std::uint8_t sMaxCodeBitsLength, std::uint16_t sMaxSymbolValue,
+          std::uint16_t sNbLiteralSymbols = 0>
 class HuffmanTree {
  public:
   friend class HuffmanTreeBuilder<SymbolType, sMaxCodeBitsLength,
                                   sMaxSymbolValue>;
 
-  template <std::integral IntType>
-  void readCode(utils::BitArray<IntType>& iBitArray,
-                SymbolType& oSymbol) const {
-    std::uint32_t aHashValue;
-    iBitArray.readLazy<sNbBitsHash>(aHashValue);
+  static constexpr std::uint8_t sMaxNbLiterals = 3;
 
-    if (_symbolValueHashExistenceArray[aHashValue]) {
-      oSymbol = _symbolValueHashArray[aHashValue];
-      iBitArray.drop(_codeBitsHashArray[aHashValue]);
-    } else {
-      iBitArray.readLazy(aHashValue);
+  // Whether some codes can be longer than the lookup table index, codes being
+  // shorter than sMaxCodeBitsLength
+  static constexpr bool sHasLongCodes = sNbBitsHash < sMaxCodeBitsLength - 1;
 
-      std::uint16_t anIndex = 0;
-      while (aHashValue < _codeComparisonArray[anIndex]) {
-        ++anIndex;
+  static_assert(sNbBitsHash > 0 && sNbBitsHash < 16,
+                "sNbBitsHash must be in [1, 15].");
+  static_assert(sizeof(SymbolType) <= sizeof(std::uint16_t),
+                "SymbolType must fit in a lookup entry.");
+  static_assert(sNbLiteralSymbols <= 0x100, "Literals must fit in a byte.");
+
+  // The bit array is not refilled, it must hold at least 32 bits.
+  // Bits matching no code read as SymbolType{} and mark the bit array
+  // corrupted.
+  template <std::integral IntType, typename SkipPolicy>
+  void readCode(utils::BitArray<IntType, SkipPolicy>& iBitArray,
+                SymbolType& oSymbol) const {
+    std::uint32_t aHashValue = iBitArray.peek(_nbBitsHash);
+
+    LookupEntry anEntry = _lookupArray[aHashValue];
+    if constexpr (sHasLongCodes) {
+      if (anEntry.nbSubBits != 0) {
+        aHashValue = iBitArray.peek(_nbBitsHash + anEntry.nbSubBits);
+        anEntry =
+            _subLookupArray[anEntry.value +
+                            (aHashValue & ((1 << anEntry.nbSubBits) - 1))];
       }
+    }
 
-      std::uint8_t aNbBits = _codeBitsArray[anIndex];
-      oSymbol =
-          _symbolValueArray[_symbolValueArrayOffsetArray[anIndex] -
-                            ((aHashValue - _codeComparisonArray[anIndex]) >>
-                             (32 - aNbBits))];
-      iBitArray.drop(aNbBits);
+    if (anEntry.nbBits != 0) [[likely]] {
+      oSymbol = static_cast<SymbolType>(anEntry.value);
+      iBitArray.consume(anEntry.nbBits);
+    } else {
+      readCodeSlow(iBitArray, oSymbol);
     }
   }
 
+  // Reads a run of literals with a single probe. oLiterals must have room for
+  // sMaxNbLiterals bytes. Returns the number of literals read, 0 when the next
+  // code is not a literal fitting in the lookup table.
+  // The bit array is not refilled, it must hold at least sNbBitsHash bits.
+  template <std::integral IntType, typename SkipPolicy>
+  std::uint8_t readLiterals(utils::BitArray<IntType, SkipPolicy>& iBitArray,
+                            std::byte* oLiterals) const
+    requires(sNbLiteralSymbols != 0)
+  {
+    const LiteralRunEntry& anEntry =
+        _literalRunArray[iBitArray.peek(_nbBitsHash)];
+    if (anEntry.nbLiterals != 0) {
+      std::memcpy(oLiterals, anEntry.literals.data(), sMaxNbLiterals);
+      iBitArray.consume(anEntry.nbBits);
+    }
+    return anEntry.nbLiterals;
+  }
+
+  // Length of the longest code
+  constexpr std::uint8_t maxNbBits() const { return _maxNbBits; }
+
  private:
-  void clear() {
-    _codeComparisonArray.fill(0);
-    _symbolValueArrayOffsetArray.fill(0);
-    _symbolValueArray.fill(0);
-    _codeBitsArray.fill(0);
-
-    _symbolValueHashExistenceArray.fill(false);
-    _symbolValueHashArray.fill(0);
-    _codeBitsHashArray.fill(0);
+  // nbBits == 0 && nbSubBits == 0: code not in the tables, use the slow path
+  // nbBits == 0 && nbSubBits != 0: value is the offset of a second level table
+  //                                indexed by the nbSubBits next bits
+  // nbBits != 0:                   value is the symbol, nbBits its code length
+  struct LookupEntry {
+    std::uint16_t value;
+    std::uint8_t nbBits;
+    std::uint8_t nbSubBits;
+  };
+
+  struct LiteralRunEntry {
+    std::array<std::byte, sMaxNbLiterals> literals;
+    std::uint8_t nbBits : 4;
+    std::uint8_t nbLiterals : 4;
+  };
+
+  template <std::integral IntType, typename SkipPolicy>
+  void readCodeSlow(utils::BitArray<IntType, SkipPolicy>& iBitArray,
+                    SymbolType& oSymbol) const {
+    std::uint32_t aHashValue = iBitArray.template peek<32>();
+
+    std::uint16_t anIndex = 0;
+    while (aHashValue < _codeComparisonArray[anIndex]) {
+      ++anIndex;
+    }
+
+    std::uint8_t aNbBits = _codeBitsArray[anIndex];
+    if (aNbBits == 0) [[unlikely]] {
+      // No code starts with these bits, the tree is incomplete
+      oSymbol = SymbolType{};
+      iBitArray.markCorrupted();
+      return;
+    }
+
+    oSymbol = _symbolValueArray[_symbolValueArrayOffsetArray[anIndex] -
+                                ((aHashValue - _codeComparisonArray[anIndex]) >>
+                                 (32 - aNbBits))];
+    iBitArray.consume(aNbBits);
+  }
+
+  // Chains the lookups of the codes following each literal for as long as
+  // they are literals and still fit in the index bits
+  constexpr void buildLiteralRunArray() {
+    const std::uint32_t aHashMask = (1 << _nbBitsHash) - 1;
+
+    for (std::uint32_t aHashValue = 0; aHashValue <= aHashMask; ++aHashValue) {
+      LiteralRunEntry aRunEntry{};
+      std::uint32_t aRemainingHashValue = aHashValue;
+
+      while (aRunEntry.nbLiterals < sMaxNbLiterals) {
+        const LookupEntry& anEntry = _lookupArray[aRemainingHashValue];
+        if (anEntry.nbBits == 0 || anEntry.value >= sNbLiteralSymbols ||
+            aRunEntry.nbBits + anEntry.nbBits > _nbBitsHash) {
+          break;
+        }
+
+        aRunEntry.literals[aRunEntry.nbLiterals] =
+            static_cast<std::byte>(anEntry.value);
+        aRunEntry.nbBits += anEntry.nbBits;
+        ++aRunEntry.nbLiterals;
+        aRemainingHashValue =
+            (aRemainingHashValue << anEntry.nbBits) & aHashMask;
+      }
+
+      _literalRunArray[aHashValue] = aRunEntry;
+    }
   }
 
   std::array<std::uint32_t, sMaxCodeBitsLength> _codeComparisonArray;
@@ -63,133 +173,235 @@ class HuffmanTree {
   std::array<SymbolType, sMaxSymbolValue> _symbolValueArray;
   std::array<std::uint8_t, sMaxCodeBitsLength> _codeBitsArray;
 
-  std::array<bool, (1 << sNbBitsHash)> _symbolValueHashExistenceArray;
-  std::array<SymbolType, (1 << sNbBitsHash)> _symbolValueHashArray;
-  std::array<std::uint8_t, (1 << sNbBitsHash)> _codeBitsHashArray;
+  std::uint8_t _maxNbBits;
+  std::uint8_t _nbBitsHash;
+  std::array<LookupEntry, (1 << sNbBitsHash)> _lookupArray;
+  std::array<LookupEntry, (1 << sNbBitsHash)> _subLookupArray;
+  std::array<LiteralRunEntry, sNbLiteralSymbols != 0 ? (1 << sNbBitsHash) : 0>
+      _literalRunArray;
 };
 
+// Codes are assigned canonically from the number of symbols of each length:
+// by increasing length, and within a length by decreasing code in the reverse
+// order the symbols were added.
 template <std::integral SymbolType, std::uint8_t sMaxCodeBitsLength,
           std::uint16_t sMaxSymbolValue>
 class HuffmanTreeBuilder {
  public:
-  void clear() {
-    _symbolListByBitsHeadExistenceArray.fill(false);
-    _symbolListByBitsHeadArray.fill(0);
+  constexpr void clear() {
+    _nbSymbolsByBitsArray.fill(0);
+    _nbSymbolGroups = 0;
+  }
 
-    _symbolListByBitsBodyExistenceArray.fill(false);
-    _symbolListByBitsBodyArray.fill(0);
+  constexpr void addSymbol(SymbolType iSymbol, std::uint8_t iNbBits) {
+    addSymbols(iSymbol, 1, iNbBits);
   }
 
-  void addSymbol(SymbolType iSymbol, std::uint8_t iNbBits) {
-    if (_symbolListByBitsHeadExistenceArray[iNbBits]) {
-      _symbolListByBitsBodyArray[iSymbol] = _symbolListByBitsHeadArray[iNbBits];
-      _symbolListByBitsBodyExistenceArray[iSymbol] = true;
-      _symbolListByBitsHeadArray[iNbBits] = iSymbol;
-    } else {
-      _symbolListByBitsHeadArray[iNbBits] = iSymbol;
-      _symbolListByBitsHeadExistenceArray[iNbBits] = true;
-    }
+  // Adds iSymbol, iSymbol - 1, ..., iSymbol - iNbSymbols + 1 in this order
+  constexpr void addSymbols(SymbolType iSymbol, std::uint16_t iNbSymbols,
+                            std::uint8_t iNbBits) {
+    assert(iNbBits > 0 && iNbBits < sMaxCodeBitsLength &&
+           "Invalid code length.");
+    assert(_nbSymbolGroups < sMaxSymbolValue && "Too many symbols.");
+
+    _symbolGroupArray[_nbSymbolGroups] =
+        SymbolGroup{iSymbol, iNbSymbols, iNbBits};
+    ++_nbSymbolGroups;
+    _nbSymbolsByBitsArray[iNbBits] += iNbSymbols;
   }
 
-  template <std::uint8_t sNbBitsHash>
-  bool buildHuffmanTree(HuffmanTree<SymbolType, sNbBitsHash, sMaxCodeBitsLength,
-                                    sMaxSymbolValue>& oHuffmanTree) {
+  template <std::uint8_t sNbBitsHash, std::uint16_t sNbLiteralSymbols>
+  constexpr bool buildHuffmanTree(
+      HuffmanTree<SymbolType, sNbBitsHash, sMaxCodeBitsLength, sMaxSymbolValue,
+                  sNbLiteralSymbols>& oHuffmanTree) {
+    using LookupEntry =
+        typename HuffmanTree<SymbolType, sNbBitsHash, sMaxCodeBitsLength,
+                             sMaxSymbolValue, sNbLiteralSymbols>::LookupEntry;
+
     if (empty()) {
       return false;
     }
 
-    oHuffmanTree.clear();
+    // The lookup table does not need to be wider than the longest code, unless
+    // it has to hold literal runs
+    std::uint8_t aMaxNbBits = sMaxCodeBitsLength - 1;
+    while (_nbSymbolsByBitsArray[aMaxNbBits] == 0) {
+      --aMaxNbBits;
+    }
+    const std::uint8_t aNbBitsHash = sNbLiteralSymbols != 0
+                                         ? sNbBitsHash
+                                         : std::min(aMaxNbBits, sNbBitsHash);
 
-    // Building the HuffmanTree
-    std::uint32_t aCode = 0;
-    std::uint8_t aNbBits = 0;
-
-    // First part, filling hashTable for codes that are of less than 8 bits
-    while (aNbBits <= sNbBitsHash) {
-      bool anExistence = _symbolListByBitsHeadExistenceArray[aNbBits];
-
-      if (anExistence) {
-        SymbolType aCurrentSymbol = _symbolListByBitsHeadArray[aNbBits];
-
-        while (anExistence) {
-          // Processing hash values
-          std::uint16_t aHashValue = aCode << (sNbBitsHash - aNbBits);
-          std::uint16_t aNextHashValue = (aCode + 1) << (sNbBitsHash - aNbBits);
-
-          while (aHashValue < aNextHashValue) {
-            oHuffmanTree._symbolValueHashExistenceArray[aHashValue] = true;
-            oHuffmanTree._symbolValueHashArray[aHashValue] = aCurrentSymbol;
-            oHuffmanTree._codeBitsHashArray[aHashValue] = aNbBits;
-            ++aHashValue;
-          }
+    oHuffmanTree._maxNbBits = aMaxNbBits;
+    oHuffmanTree._nbBitsHash = aNbBitsHash;
 
-          anExistence = _symbolListByBitsBodyExistenceArray[aCurrentSymbol];
-          aCurrentSymbol = _symbolListByBitsBodyArray[aCurrentSymbol];
-          --aCode;
-        }
+    // Sorting the symbols by code length
+    std::array<std::uint16_t, sMaxCodeBitsLength> aSymbolOffsetByBitsArray{};
+    std::uint16_t aSymbolOffset = 0;
+    for (std::uint8_t aNbBits = 1; aNbBits <= aMaxNbBits; ++aNbBits) {
+      aSymbolOffsetByBitsArray[aNbBits] = aSymbolOffset;
+      aSymbolOffset += _nbSymbolsByBitsArray[aNbBits];
+    }
+    for (std::uint16_t aGroupIndex = _nbSymbolGroups; aGroupIndex-- > 0;) {
+      const SymbolGroup& aGroup = _symbolGroupArray[aGroupIndex];
+      std::uint16_t& ioOffset = aSymbolOffsetByBitsArray[aGroup.nbBits];
+      for (std::uint16_t i = aGroup.nbSymbols; i-- > 0;) {
+        _sortedSymbolArray[ioOffset] = aGroup.symbol - i;
+        ++ioOffset;
       }
-
-      aCode = (aCode << 1) + 1;
-      ++aNbBits;
     }
 
+    // Building the HuffmanTree
+    std::uint32_t aCode = 1;
+    std::uint16_t aSymbolIndex = 0;
     std::uint16_t aCodeComparisonArrayIndex = 0;
-    std::uint16_t aSymbolOffset = 0;
+    std::uint16_t aLongSymbolOffset = 0;
 
-    // Second part, filling classical structure for other codes
-    while (aNbBits < sMaxCodeBitsLength) {
-      bool anExistence = _symbolListByBitsHeadExistenceArray[aNbBits];
+    // Lookup entries below it are not filled
+    std::uint32_t aFirstFilledHashValue = std::uint32_t{1} << aNbBitsHash;
 
-      if (anExistence) {
-        SymbolType aCurrentSymbol = _symbolListByBitsHeadArray[aNbBits];
+    for (std::uint8_t aNbBits = 1; aNbBits <= aMaxNbBits; ++aNbBits) {
+      const std::uint16_t aNbSymbols = _nbSymbolsByBitsArray[aNbBits];
 
-        while (anExistence) {
-          // Registering the code
-          oHuffmanTree._symbolValueArray[aSymbolOffset] = aCurrentSymbol;
-
-          ++aSymbolOffset;
-          anExistence = _symbolListByBitsBodyExistenceArray[aCurrentSymbol];
-          aCurrentSymbol = _symbolListByBitsBodyArray[aCurrentSymbol];
-          --aCode;
+      if (aNbSymbols != 0) {
+        if (aCode >= (std::uint32_t{1} << aNbBits) || aNbSymbols - 1u > aCode) {
+          return false;  // Over-subscribed code lengths
         }
 
-        // Minimum code value for aNbBits bits
-        oHuffmanTree._codeComparisonArray[aCodeComparisonArrayIndex] =
-            ((aCode + 1) << (32 - aNbBits));
+        if (aNbBits <= aNbBitsHash) {
+          // First part, filling the lookup table for codes that fit in it
+          const std::uint32_t aNbHashValues = std::uint32_t{1}
+                                              << (aNbBitsHash - aNbBits);
+          for (std::uint16_t i = 0; i < aNbSymbols; ++i) {
+            std::fill_n(oHuffmanTree._lookupArray.begin() +
+                            ((aCode - i) << (aNbBitsHash - aNbBits)),
+                        aNbHashValues,
+                        LookupEntry{static_cast<std::uint16_t>(
+                                        _sortedSymbolArray[aSymbolIndex + i]),
+                                    aNbBits, 0});
+          }
+          aFirstFilledHashValue = (aCode - aNbSymbols + 1)
+                                  << (aNbBitsHash - aNbBits);
+        } else {
+          // Second part, filling classical structure for other codes
+          for (std::uint16_t i = 0; i < aNbSymbols; ++i) {
+            oHuffmanTree._symbolValueArray[aLongSymbolOffset] =
+                _sortedSymbolArray[aSymbolIndex + i];
+            _longCodeArray[aLongSymbolOffset] = aCode - i;
+            _longCodeBitsArray[aLongSymbolOffset] = aNbBits;
+            ++aLongSymbolOffset;
+          }
+
+          // Minimum code value for aNbBits bits
+          oHuffmanTree._codeComparisonArray[aCodeComparisonArrayIndex] =
+              ((aCode - aNbSymbols + 1) << (32 - aNbBits));
 
-        // Number of bits for l_codeCompIndex index
-        oHuffmanTree._codeBitsArray[aCodeComparisonArrayIndex] = aNbBits;
+          // Number of bits for l_codeCompIndex index
+          oHuffmanTree._codeBitsArray[aCodeComparisonArrayIndex] = aNbBits;
 
-        // Offset in symbolValueTab table to reach the value
-        oHuffmanTree._symbolValueArrayOffsetArray[aCodeComparisonArrayIndex] =
-            aSymbolOffset - 1;
+          // Offset in symbolValueTab table to reach the value
+          oHuffmanTree._symbolValueArrayOffsetArray[aCodeComparisonArrayIndex] =
+              aLongSymbolOffset - 1;
 
-        ++aCodeComparisonArrayIndex;
+          ++aCodeComparisonArrayIndex;
+        }
+
+        aSymbolIndex += aNbSymbols;
+        aCode -= aNbSymbols;
       }
 
       aCode = (aCode << 1) + 1;
-      ++aNbBits;
     }
 
-    return true;
-  }
+    // Terminating the scan of the slow path
+    oHuffmanTree._codeComparisonArray[aCodeComparisonArrayIndex] = 0;
+    oHuffmanTree._codeBitsArray[aCodeComparisonArrayIndex] = 0;
+
+    // Third part, second level tables for the long codes. Codes are assigned
+    // in decreasing order, so codes sharing a prefix are contiguous and the
+    // last one is the longest.
+    std::uint16_t aSubLookupSize = 0;
+    std::uint16_t aFirstIndex = 0;
+    while (aFirstIndex < aLongSymbolOffset) {
+      std::uint32_t aPrefix = _longCodeArray[aFirstIndex] >>
+                              (_longCodeBitsArray[aFirstIndex] - aNbBitsHash);
+
+      std::uint16_t aLastIndex = aFirstIndex + 1;
+      while (aLastIndex < aLongSymbolOffset &&
+             (_longCodeArray[aLastIndex] >>
+              (_longCodeBitsArray[aLastIndex] - aNbBitsHash)) == aPrefix) {
+        ++aLastIndex;
+      }
 
- private:
-  bool empty() const {
-    for (auto it = _symbolListByBitsHeadExistenceArray.begin();
-         it != _symbolListByBitsHeadExistenceArray.end(); ++it) {
-      if (*it == true) {
-        return false;
+      std::uint8_t aNbSubBits =
+          _longCodeBitsArray[aLastIndex - 1] - aNbBitsHash;
+      std::uint32_t aNbSubEntries = std::uint32_t{1} << aNbSubBits;
+
+      // Out of room, these codes are left to the slow path
+      if (aNbSubBits < 16 &&
+          aSubLookupSize + aNbSubEntries <=
+              oHuffmanTree._subLookupArray.size()) {
+        oHuffmanTree._lookupArray[aPrefix] =
+            LookupEntry{aSubLookupSize, 0, aNbSubBits};
+
+        auto aSubLookupIt =
+            oHuffmanTree._subLookupArray.begin() + aSubLookupSize;
+        std::fill_n(aSubLookupIt, aNbSubEntries, LookupEntry{});
+
+        for (std::uint16_t anIndex = aFirstIndex; anIndex < aLastIndex;
+             ++anIndex) {
+          std::uint8_t aNbBitsLeft =
+              _longCodeBitsArray[anIndex] - aNbBitsHash;
+          std::uint32_t aSubHashValue =
+              (_longCodeArray[anIndex] & ((1 << aNbBitsLeft) - 1))
+              << (aNbSubBits - aNbBitsLeft);
+
+          std::fill_n(aSubLookupIt + aSubHashValue,
+                      std::uint32_t{1} << (aNbSubBits - aNbBitsLeft),
+                      LookupEntry{static_cast<std::uint16_t>(
+                                      oHuffmanTree._symbolValueArray[anIndex]),
+                                  _longCodeBitsArray[anIndex], 0});
+        }
+
+        aSubLookupSize += aNbSubEntries;
+      } else {
+        oHuffmanTree._lookupArray[aPrefix] = LookupEntry{};
       }
+
+      aFirstFilledHashValue = aPrefix;
+      aFirstIndex = aLastIndex;
+    }
+
+    // Bits starting no code, the tree is incomplete
+    std::fill_n(oHuffmanTree._lookupArray.begin(), aFirstFilledHashValue,
+                LookupEntry{});
+
+    if constexpr (sNbLiteralSymbols != 0) {
+      oHuffmanTree.buildLiteralRunArray();
     }
+
     return true;
   }
 
-  std::array<bool, sMaxCodeBitsLength> _symbolListByBitsHeadExistenceArray;
-  std::array<SymbolType, sMaxCodeBitsLength> _symbolListByBitsHeadArray;
+ private:
+  struct SymbolGroup {
+    SymbolType symbol;
+    std::uint16_t nbSymbols;
+    std::uint8_t nbBits;
+  };
+
+  constexpr bool empty() const { return _nbSymbolGroups == 0; }
+
+  std::array<std::uint16_t, sMaxCodeBitsLength> _nbSymbolsByBitsArray;
+  std::array<SymbolGroup, sMaxSymbolValue> _symbolGroupArray;
+  std::uint16_t _nbSymbolGroups;
+
+  // Symbols sorted by code length
+  std::array<SymbolType, sMaxSymbolValue> _sortedSymbolArray;
 
-  std::array<bool, sMaxSymbolValue> _symbolListByBitsBodyExistenceArray;
-  std::array<SymbolType, sMaxSymbolValue> _symbolListByBitsBodyArray;
+  // Long codes, in the order of _symbolValueArray
+  std::array<std::uint32_t, sMaxSymbolValue> _longCodeArray;
+  std::array<std::uint8_t, sMaxSymbolValue> _longCodeBitsArray;
 };
 
 }  // namespace gw2::compression
@@ -2,208 +2,140 @@
 
 #include <memory.h>
 
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "BitArray.hpp"
+#include "BoundedQueue.hpp"
+#include "CopyMatch.hpp"
+#include "CpuDispatch.hpp"
 #include "HuffmanTree.hpp"
+#include "Xxh64.hpp"
 
 namespace gw2::compression {
 namespace dat {
 
-static constexpr std::uint32_t sDatFileNbBitsHash = 8;
+// Lookup table widths, the dictionary codes are at most 16 bits long
+static constexpr std::uint32_t sDatFileDictNbBitsHash = 10;
+static constexpr std::uint32_t sDatFileSymbolNbBitsHash = 11;
+static constexpr std::uint32_t sDatFileCopyNbBitsHash = 10;
 static constexpr std::uint32_t sDatFileMaxCodeBitsLength = 32;
 static constexpr std::uint32_t sDatFileMaxSymbolValue = 285;
 
-using DatFileBitArray = utils::BitArray<std::uint32_t>;
-using DatFileHuffmanTree =
-    HuffmanTree<std::uint16_t, sDatFileNbBitsHash, sDatFileMaxCodeBitsLength,
-                sDatFileMaxSymbolValue>;
-using DatFileHuffmanTreeBuilder =
-    HuffmanTreeBuilder<std::uint16_t, sDatFileMaxCodeBitsLength,
-                       sDatFileMaxSymbolValue>;
-
-static DatFileHuffmanTree sDatFileHuffmanTreeDict;
-
-// Parse and build a huffmanTree
-bool parseHuffmanTree(DatFileBitArray& ioInputBitArray,
-                      DatFileHuffmanTree& ioHuffmanTree,
-                      DatFileHuffmanTreeBuilder& ioHuffmanTreeBuilder) {
-  // Reading the number of symbols to read
-  std::uint16_t aNumberOfSymbols;
-  ioInputBitArray.read(aNumberOfSymbols);
-  ioInputBitArray.drop<std::uint16_t>();
-
-  assert(aNumberOfSymbols <= sDatFileMaxSymbolValue &&
-         "Too many symbols to decode.");
-
-  ioHuffmanTreeBuilder.clear();
+// Valid symbols: literals and write sizes, then write offsets
+static constexpr std::uint16_t sDatFileNbWriteSizeSymbols = 27;
+static constexpr std::uint16_t sDatFileNbSymbols =
+    0x100 + sDatFileNbWriteSizeSymbols;
+static constexpr std::uint16_t sDatFileNbCopySymbols = 34;
 
-  std::int16_t aRemainingSymbols = aNumberOfSymbols - 1;
+// Longest additional bits fields of a write size and of a write offset
+static constexpr std::uint8_t sDatFileMaxWriteSizeAddBits = 5;
+static constexpr std::uint8_t sDatFileMaxWriteOffsetAddBits = 15;
 
-  // Fetching the code repartition
-  while (aRemainingSymbols >= 0) {
-    std::uint16_t aCode;
+// Copy codes decode as base + the next nbAddBits bits
+struct DatFileCopyDescriptor {
+  std::uint32_t base;
+  std::uint8_t nbAddBits;
+};
 
-    sDatFileHuffmanTreeDict.readCode(ioInputBitArray, aCode);
+// Indexed by symbol - 0x100, the write size constant addition is not included
+static constexpr auto sDatFileWriteSizeDescriptorArray = [] {
+  constexpr auto write_count = std::array{
+      0,  1,  2,  3,  4,  5,  6,  7,  8,   10,  12,  14,  16,  20,  24,
+      28, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 255,
+  };
+  constexpr auto bit_count = std::array{
+      0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+  };
 
-    std::uint8_t aCodeNumberOfBits = aCode & 0x1F;
-    std::uint16_t aCodeNumberOfSymbols = (aCode >> 5) + 1;
+  std::array<DatFileCopyDescriptor, sDatFileNbWriteSizeSymbols>
+      aDescriptorArray{};
+  for (std::size_t i = 0; i < aDescriptorArray.size(); ++i) {
+    aDescriptorArray[i] = {static_cast<std::uint32_t>(write_count[i]),
+                           static_cast<std::uint8_t>(bit_count[i])};
+  }
+  return aDescriptorArray;
+}();
 
-    if (aCodeNumberOfBits == 0) {
-      aRemainingSymbols -= aCodeNumberOfSymbols;
+// Indexed by symbol
+static constexpr auto sDatFileWriteOffsetDescriptorArray = [] {
+  std::array<DatFileCopyDescriptor, sDatFileNbCopySymbols> aDescriptorArray{};
+  for (std::uint32_t aSymbol = 0; aSymbol < aDescriptorArray.size();
+       ++aSymbol) {
+    std::uint32_t aQuot = aSymbol / 2;
+    std::uint32_t aRem = aSymbol % 2;
+    if (aQuot == 0) {
+      aDescriptorArray[aSymbol] = {aSymbol + 1, 0};
     } else {
-      while (aCodeNumberOfSymbols > 0) {
-        ioHuffmanTreeBuilder.addSymbol(aRemainingSymbols, aCodeNumberOfBits);
-        --aRemainingSymbols;
-        --aCodeNumberOfSymbols;
-      }
+      aDescriptorArray[aSymbol] = {(1u << (aQuot - 1)) * (2 + aRem) + 1,
+                                   static_cast<std::uint8_t>(aQuot - 1)};
     }
   }
+  return aDescriptorArray;
+}();
 
-  return ioHuffmanTreeBuilder.buildHuffmanTree(ioHuffmanTree);
-}
-
-void inflatedata(DatFileBitArray& ioInputBitArray, std::uint32_t iOutputSize,
-                 std::byte* ioOutputTab) {
-  std::uint32_t anOutputPos = 0;
-
-  std::uint8_t method;
-  ioInputBitArray.read<4>(method);
-  // Reading the const write size addition value
-  ioInputBitArray.drop<4>();
-  std::uint16_t aWriteSizeConstAdd;
-  ioInputBitArray.read<4>(aWriteSizeConstAdd);
-  aWriteSizeConstAdd += 1;
-  ioInputBitArray.drop<4>();
-
-  // Declaring our HuffmanTrees
-  DatFileHuffmanTree aHuffmanTreeSymbol;
-  DatFileHuffmanTree aHuffmanTreeCopy;  // distance
-
-  DatFileHuffmanTreeBuilder aHuffmanTreeBuilder;
-
-  while (anOutputPos < iOutputSize) {
-    // Reading HuffmanTrees
-    if (!parseHuffmanTree(ioInputBitArray, aHuffmanTreeSymbol,
-                          aHuffmanTreeBuilder) ||
-        !parseHuffmanTree(ioInputBitArray, aHuffmanTreeCopy,
-                          aHuffmanTreeBuilder)) {
-      break;
-    }
-
-    // Reading MaxCount
-    std::uint32_t aMaxCount;
-    ioInputBitArray.read<4>(aMaxCount);
-    aMaxCount = (aMaxCount + 1) << 12;
-    ioInputBitArray.drop<4>();
-
-    std::uint32_t aCurrentCodeReadCount = 0;
-
-    while ((aCurrentCodeReadCount < aMaxCount) && (anOutputPos < iOutputSize)) {
-      ++aCurrentCodeReadCount;
-
-      // Reading next code
-      std::uint16_t aSymbol;
-      aHuffmanTreeSymbol.readCode(ioInputBitArray, aSymbol);
-
-      if (aSymbol < 0x100) {
-        ioOutputTab[anOutputPos] = static_cast<std::byte>(aSymbol);
-        ++anOutputPos;
-        continue;
-      }
-
-      // We are in copy mode !
-      // Reading the additional info to know the write size
-      aSymbol -= 0x100;
-
-      constexpr auto write_count = std::array{
-          0,  1,  2,  3,  4,  5,  6,  7,  8,   10,  12,  14,  16,  20,  24,
-          28, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 255,
-      };
-      constexpr auto bit_count = std::array{
-          0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
-          2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
-      };
-
-      assert(aSymbol < 27);
-
-      std::uint16_t aWriteSize = write_count[aSymbol];
-      auto b = bit_count[aSymbol];
-      if (b > 0) {
-        std::uint32_t writeSizeAdd;
-        ioInputBitArray.read(b, writeSizeAdd);
-        aWriteSize |= writeSizeAdd;
-        ioInputBitArray.drop(b);
-      }
-
-      // write size
-      aWriteSize += aWriteSizeConstAdd;
-
-      // write offset
-      // Reading the write offset
-      aHuffmanTreeCopy.readCode(ioInputBitArray, aSymbol);
-
-      std::div_t aCodeDiv2 = std::div(aSymbol, 2);
-
-      std::uint32_t aWriteOffset = 0;
-      if (aCodeDiv2.quot == 0) {
-        aWriteOffset = aSymbol;
-      } else if (aCodeDiv2.quot < 17) {
-        aWriteOffset = ((1 << (aCodeDiv2.quot - 1)) * (2 + aCodeDiv2.rem));
-      } else {
-        assert(false && "Invalid value for writeOffset code.");
-      }
-
-      // additional bits
-      if (aCodeDiv2.quot > 1) {
-        std::uint8_t aWriteOffsetAddBits = aCodeDiv2.quot - 1;
-        std::uint32_t aWriteOffsetAdd;
-        ioInputBitArray.read(aWriteOffsetAddBits, aWriteOffsetAdd);
-        aWriteOffset |= aWriteOffsetAdd;
-        ioInputBitArray.drop(aWriteOffsetAddBits);
-      }
-      aWriteOffset += 1;
-
-      std::uint32_t anAlreadyWritten = 0;
-      while ((anAlreadyWritten < aWriteSize) && (anOutputPos < iOutputSize)) {
-        ioOutputTab[anOutputPos] = ioOutputTab[anOutputPos - aWriteOffset];
-        ++anOutputPos;
-        ++anAlreadyWritten;
-      }
-    }
+// Largest value decoded through a descriptor table
+static constexpr std::uint32_t maxCopyValue(
+    std::span<const DatFileCopyDescriptor> iDescriptorArray) {
+  std::uint32_t aMaxValue = 0;
+  for (const DatFileCopyDescriptor& aDescriptor : iDescriptorArray) {
+    aMaxValue = std::max(
+        aMaxValue, aDescriptor.base + (1u << aDescriptor.nbAddBits) - 1);
   }
+  return aMaxValue;
 }
-}  // namespace dat
-
-Result<std::uint32_t> inflateDatFileBuffer(std::span<const std::byte> iInputTab,
-                                           std::span<std::byte> ioOutputTab) {
-  if (iInputTab.empty()) {
-    return std::unexpected{Error::kInputBufferIsEmpty};
-  }
-
-  if (ioOutputTab.empty()) {
-    return std::unexpected{Error::kOutputBufferIsEmpty};
-  }
-
-  dat::DatFileBitArray anInputBitArray(
-      iInputTab, 0xffff);  // Skipping four bytes every 65k chunk
 
-  dat::inflatedata(anInputBitArray, ioOutputTab.size(), ioOutputTab.data());
-  anInputBitArray.drop<1>();
+// Longest write size, with the largest write size constant addition
+static constexpr std::uint32_t sDatFileMaxWriteSize =
+    maxCopyValue(sDatFileWriteSizeDescriptorArray) + 0x10;
+static constexpr std::uint32_t sDatFileMaxWriteOffset =
+    maxCopyValue(sDatFileWriteOffsetDescriptorArray);
 
-  return 0;
-}
+static_assert(std::ranges::all_of(sDatFileWriteSizeDescriptorArray,
+                                  [](const DatFileCopyDescriptor& iDescriptor) {
+                                    return iDescriptor.nbAddBits <=
+                                           sDatFileMaxWriteSizeAddBits;
+                                  }));
+static_assert(std::ranges::all_of(sDatFileWriteOffsetDescriptorArray,
+                                  [](const DatFileCopyDescriptor& iDescriptor) {
+                                    return iDescriptor.nbAddBits <=
+                                           sDatFileMaxWriteOffsetAddBits;
+                                  }));
 
-class DatFileHuffmanTreeDictStaticInitializer {
- public:
-  DatFileHuffmanTreeDictStaticInitializer(
-      dat::DatFileHuffmanTree& ioHuffmanTree);
-};
+// Skipping four bytes every 65k chunk, the first chunk being 12 bytes shorter
+using DatFileSkipPolicy = utils::EveryNWordsSkipPolicy<0x4000, 0x3ffd>;
+using DatFileBitArray = utils::BitArray<std::uint32_t, DatFileSkipPolicy>;
+template <std::uint8_t sNbBitsHash, std::uint16_t sNbLiteralSymbols = 0>
+using DatFileHuffmanTree =
+    HuffmanTree<std::uint16_t, sNbBitsHash, sDatFileMaxCodeBitsLength,
+                sDatFileMaxSymbolValue, sNbLiteralSymbols>;
+using DatFileHuffmanTreeDict = DatFileHuffmanTree<sDatFileDictNbBitsHash>;
+using DatFileHuffmanTreeSymbol =
+    DatFileHuffmanTree<sDatFileSymbolNbBitsHash, 0x100>;  // Literals: < 0x100
+using DatFileHuffmanTreeCopy = DatFileHuffmanTree<sDatFileCopyNbBitsHash>;
+using DatFileHuffmanTreeBuilder =
+    HuffmanTreeBuilder<std::uint16_t, sDatFileMaxCodeBitsLength,
+                       sDatFileMaxSymbolValue>;
 
-DatFileHuffmanTreeDictStaticInitializer::
-    DatFileHuffmanTreeDictStaticInitializer(
-        dat::DatFileHuffmanTree& ioHuffmanTree) {
-  dat::DatFileHuffmanTreeBuilder aDatFileHuffmanTreeBuilder;
+// The dictionary of the code lengths of the other trees
+static constexpr DatFileHuffmanTreeDict makeDatFileHuffmanTreeDict() {
+  DatFileHuffmanTreeDict aHuffmanTree{};
+  DatFileHuffmanTreeBuilder aDatFileHuffmanTreeBuilder{};
   aDatFileHuffmanTreeBuilder.clear();
 
   aDatFileHuffmanTreeBuilder.addSymbol(0x0A, 3);
@@ -476,10 +408,2227 @@ DatFileHuffmanTreeDictStaticInitializer::
   aDatFileHuffmanTreeBuilder.addSymbol(0x13, 16);
   aDatFileHuffmanTreeBuilder.addSymbol(0x12, 16);
 
-  aDatFileHuffmanTreeBuilder.buildHuffmanTree(ioHuffmanTree);
+  aDatFileHuffmanTreeBuilder.buildHuffmanTree(aHuffmanTree);
+  return aHuffmanTree;
+}
+
+static constexpr DatFileHuffmanTreeDict sDatFileHuffmanTreeDict =
+    makeDatFileHuffmanTreeDict();
+
+// Code length of each symbol of a tree, identifying it
+using DatFileHuffmanTreeKey =
+    std::pair<std::array<std::uint8_t, sDatFileMaxSymbolValue>, std::uint16_t>;
+
+static std::string_view toStringView(const DatFileHuffmanTreeKey& iKey) {
+  return {reinterpret_cast<const char*>(iKey.first.data()), iKey.second};
+}
+
+// Parse a huffmanTree description into the builder, symbols from
+// iNbValidSymbols have no code. Fills opKey when it is not null.
+// Returns false for an empty tree, which ends the stream.
+template <typename BitArrayType>
+Result<bool> parseHuffmanTree(BitArrayType& ioInputBitArray,
+                              DatFileHuffmanTreeBuilder& ioHuffmanTreeBuilder,
+                              std::uint16_t iNbValidSymbols,
+                              DatFileHuffmanTreeKey* opKey) {
+  // Reading the number of symbols to read
+  std::uint16_t aNumberOfSymbols;
+  ioInputBitArray.read(aNumberOfSymbols);
+  ioInputBitArray.template drop<std::uint16_t>();
+
+  if (aNumberOfSymbols > sDatFileMaxSymbolValue) {
+    return std::unexpected{Error::kInvalidHuffmanTree};
+  }
+
+  ioHuffmanTreeBuilder.clear();
+  if (opKey != nullptr) {
+    std::fill_n(opKey->first.begin(), aNumberOfSymbols, 0);
+    opKey->second = aNumberOfSymbols;
+  }
+
+  std::int16_t aRemainingSymbols = aNumberOfSymbols - 1;
+  bool anEmptyTree = true;
+
+  // Fetching the code repartition
+  while (aRemainingSymbols >= 0) {
+    std::uint16_t aCode;
+
+    sDatFileHuffmanTreeDict.readCode(ioInputBitArray, aCode);
+    ioInputBitArray.refill();
+
+    std::uint8_t aCodeNumberOfBits = aCode & 0x1F;
+    std::uint16_t aCodeNumberOfSymbols = (aCode >> 5) + 1;
+
+    if (aCodeNumberOfSymbols > aRemainingSymbols + 1) {
+      return std::unexpected{Error::kInvalidHuffmanTree};
+    }
+
+    if (aCodeNumberOfBits == 0) {
+      aRemainingSymbols -= aCodeNumberOfSymbols;
+    } else {
+      if (aRemainingSymbols >= iNbValidSymbols) {
+        return std::unexpected{Error::kInvalidHuffmanTree};
+      }
+
+      anEmptyTree = false;
+      ioHuffmanTreeBuilder.addSymbols(aRemainingSymbols, aCodeNumberOfSymbols,
+                                      aCodeNumberOfBits);
+      aRemainingSymbols -= aCodeNumberOfSymbols;
+      if (opKey != nullptr) {
+        std::fill_n(opKey->first.begin() + aRemainingSymbols + 1,
+                    aCodeNumberOfSymbols, aCodeNumberOfBits);
+      }
+    }
+  }
+
+  return !anEmptyTree;
+}
+
+}  // namespace dat
+
+struct DatFileHuffmanTreeCache::Impl {
+  struct KeyHash {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view iKey) const {
+      return std::hash<std::string_view>{}(iKey);
+    }
+  };
+
+  template <typename HuffmanTreeType>
+  using HuffmanTreeMap =
+      std::unordered_map<std::string, std::shared_ptr<const HuffmanTreeType>,
+                         KeyHash, std::equal_to<>>;
+
+  template <typename HuffmanTreeType>
+  HuffmanTreeMap<HuffmanTreeType>& huffmanTreeMap() {
+    if constexpr (std::is_same_v<HuffmanTreeType,
+                                 dat::DatFileHuffmanTreeSymbol>) {
+      return huffmanTreeSymbolMap;
+    } else {
+      return huffmanTreeCopyMap;
+    }
+  }
+
+  template <typename HuffmanTreeType>
+  std::shared_ptr<const HuffmanTreeType> find(std::string_view iKey) {
+    std::lock_guard aLock(mutex);
+    auto& aHuffmanTreeMap = huffmanTreeMap<HuffmanTreeType>();
+    auto it = aHuffmanTreeMap.find(iKey);
+    if (it == aHuffmanTreeMap.end()) {
+      return nullptr;
+    }
+    return it->second;
+  }
+
+  template <typename HuffmanTreeType>
+  void insert(std::string_view iKey,
+              std::shared_ptr<const HuffmanTreeType> ipHuffmanTree) {
+    std::lock_guard aLock(mutex);
+    if (huffmanTreeSymbolMap.size() + huffmanTreeCopyMap.size() >=
+        maxNbTrees) {
+      huffmanTreeSymbolMap.clear();
+      huffmanTreeCopyMap.clear();
+    }
+    huffmanTreeMap<HuffmanTreeType>().emplace(iKey, std::move(ipHuffmanTree));
+  }
+
+  const std::size_t maxNbTrees;
+
+  std::mutex mutex;
+  HuffmanTreeMap<dat::DatFileHuffmanTreeSymbol> huffmanTreeSymbolMap;
+  HuffmanTreeMap<dat::DatFileHuffmanTreeCopy> huffmanTreeCopyMap;
+
+  std::atomic<std::uint64_t> nbHits{0};
+  std::atomic<std::uint64_t> nbMisses{0};
+};
+
+DatFileHuffmanTreeCache::DatFileHuffmanTreeCache(std::size_t iMaxNbTrees)
+    : _pImpl(std::make_unique<Impl>(iMaxNbTrees)) {}
+
+DatFileHuffmanTreeCache::~DatFileHuffmanTreeCache() = default;
+
+std::uint64_t DatFileHuffmanTreeCache::nbHits() const {
+  return _pImpl->nbHits.load(std::memory_order_relaxed);
+}
+
+std::uint64_t DatFileHuffmanTreeCache::nbMisses() const {
+  return _pImpl->nbMisses.load(std::memory_order_relaxed);
+}
+
+void DatFileHuffmanTreeCache::clear() {
+  std::lock_guard aLock(_pImpl->mutex);
+  _pImpl->huffmanTreeSymbolMap.clear();
+  _pImpl->huffmanTreeCopyMap.clear();
+}
+
+namespace dat {
+
+// Parse a huffmanTree and build it in ioHuffmanTree, or take it from ipCache
+// when it is not null, keeping it alive in oCachedHuffmanTree.
+// Returns null for an empty tree, which ends the stream.
+template <typename BitArrayType, typename HuffmanTreeType>
+Result<const HuffmanTreeType*> readHuffmanTree(
+    BitArrayType& ioInputBitArray,
+    DatFileHuffmanTreeBuilder& ioHuffmanTreeBuilder,
+    std::uint16_t iNbValidSymbols, HuffmanTreeType& ioHuffmanTree,
+    DatFileHuffmanTreeCache::Impl* ipCache,
+    std::shared_ptr<const HuffmanTreeType>& oCachedHuffmanTree) {
+  DatFileHuffmanTreeKey aKey;
+  Result<bool> aHasTree =
+      parseHuffmanTree(ioInputBitArray, ioHuffmanTreeBuilder, iNbValidSymbols,
+                       ipCache != nullptr ? &aKey : nullptr);
+  if (!aHasTree) {
+    return std::unexpected{aHasTree.error()};
+  }
+  if (!*aHasTree) {
+    return nullptr;
+  }
+
+  if (ipCache == nullptr) {
+    if (!ioHuffmanTreeBuilder.buildHuffmanTree(ioHuffmanTree)) {
+      return std::unexpected{Error::kInvalidHuffmanTree};
+    }
+    return &ioHuffmanTree;
+  }
+
+  oCachedHuffmanTree = ipCache->find<HuffmanTreeType>(toStringView(aKey));
+  if (oCachedHuffmanTree != nullptr) {
+    ipCache->nbHits.fetch_add(1, std::memory_order_relaxed);
+    return oCachedHuffmanTree.get();
+  }
+  ipCache->nbMisses.fetch_add(1, std::memory_order_relaxed);
+
+  auto aHuffmanTree = std::make_shared<HuffmanTreeType>();
+  if (!ioHuffmanTreeBuilder.buildHuffmanTree(*aHuffmanTree)) {
+    return std::unexpected{Error::kInvalidHuffmanTree};
+  }
+  oCachedHuffmanTree = aHuffmanTree;
+  ipCache->insert<HuffmanTreeType>(toStringView(aKey), std::move(aHuffmanTree));
+  return oCachedHuffmanTree.get();
+}
+
+// Copies a match, byte by byte when copyMatch() could write past iOutputSize
+inline void copyDatFileMatchChecked(std::byte* ioOutputTab,
+                                    std::uint32_t iOutputPos,
+                                    std::uint32_t iWriteOffset,
+                                    std::uint32_t iWriteSize,
+                                    std::uint32_t iOutputSize) {
+  if (iOutputSize - iOutputPos - iWriteSize >= utils::sCopyMatchMaxOverrun) {
+    utils::copyMatch(&ioOutputTab[iOutputPos], iWriteOffset, iWriteSize);
+    return;
+  }
+  for (std::uint32_t i = 0; i < iWriteSize; ++i) {
+    ioOutputTab[iOutputPos + i] = ioOutputTab[iOutputPos + i - iWriteOffset];
+  }
+}
+
+// Writes the decoded tokens to the output. With sHasOutputSlack, the output is
+// followed by sDatFileOutputSlack writable bytes that the copies may overrun.
+template <bool sHasOutputSlack>
+class DatFileBufferOutput {
+ public:
+  static constexpr bool sHasSlack = sHasOutputSlack;
+
+  explicit DatFileBufferOutput(std::byte* ioOutputTab)
+      : _pOutputTab(ioOutputTab) {}
+
+  // Where to write the next literals
+  std::byte* literals(std::uint32_t iOutputPos) {
+    return &_pOutputTab[iOutputPos];
+  }
+  void addLiterals(std::uint32_t) {}
+
+  // Without sIsChecked, the match ends sDatFileFastOutputMargin bytes before
+  // the end
+  template <bool sIsChecked>
+  void addMatch(std::uint32_t iOutputPos, std::uint32_t iWriteOffset,
+                std::uint32_t iWriteSize, std::uint32_t iOutputSize) {
+    if constexpr (sIsChecked && !sHasOutputSlack) {
+      copyDatFileMatchChecked(_pOutputTab, iOutputPos, iWriteOffset, iWriteSize,
+                              iOutputSize);
+    } else {
+      utils::copyMatch(&_pOutputTab[iOutputPos], iWriteOffset, iWriteSize);
+    }
+  }
+
+  // The whole output is decoded at once
+  std::uint32_t windowEndPos(std::uint32_t iOutputSize) const {
+    return iOutputSize;
+  }
+  void endWindow(std::uint32_t) {}
+
+  // Called before reading each block
+  void startBlock(const DatFileBitArray&, std::uint32_t) {}
+
+ protected:
+  std::byte* _pOutputTab;
+};
+
+// Writes the output directly, recording a checkpoint at the first block then
+// at the first block starting iCheckpointInterval bytes after the last one
+class DatFileIndexingOutput : public DatFileBufferOutput<false> {
+ public:
+  DatFileIndexingOutput(std::byte* ioOutputTab,
+                        std::uint32_t iCheckpointInterval, DatFileIndex& oIndex)
+      : DatFileBufferOutput<false>(ioOutputTab),
+        _checkpointInterval(iCheckpointInterval),
+        _index(oIndex) {}
+
+  void startBlock(const DatFileBitArray& iInputBitArray,
+                  std::uint32_t iOutputPos) {
+    if (!_index.checkpoints.empty() &&
+        iOutputPos - _index.checkpoints.back().outputPos <
+            _checkpointInterval) {
+      return;
+    }
+    const std::uint32_t aWindowSize =
+        std::min(iOutputPos, sDatFileMaxWriteOffset);
+    _index.checkpoints.push_back(
+        {iInputBitArray.nbConsumedBits(), iOutputPos,
+         std::vector<std::byte>(&_pOutputTab[iOutputPos - aWindowSize],
+                                &_pOutputTab[iOutputPos])});
+  }
+
+ private:
+  std::uint32_t _checkpointInterval;
+  DatFileIndex& _index;
+};
+
+// Output decoded between two updates of the hash of a DatFileHashingOutput,
+// small enough to still be in cache when it is hashed
+static constexpr std::uint32_t sDatFileHashWindowStep = 1 << 15;
+
+// Writes the output directly, hashing it one window after the other
+class DatFileHashingOutput : public DatFileBufferOutput<false> {
+ public:
+  explicit DatFileHashingOutput(std::byte* ioOutputTab)
+      : DatFileBufferOutput<false>(ioOutputTab) {}
+
+  std::uint32_t windowEndPos(std::uint32_t iOutputSize) const {
+    return _hashedPos +
+           std::min(iOutputSize - _hashedPos, sDatFileHashWindowStep);
+  }
+  void endWindow(std::uint32_t iOutputPos) {
+    _hash.update({&_pOutputTab[_hashedPos], &_pOutputTab[iOutputPos]});
+    _hashedPos = iOutputPos;
+  }
+
+  // Hash of the first iOutputSize bytes, hashing the ones left
+  std::uint64_t digest(std::uint32_t iOutputSize) {
+    endWindow(iOutputSize);
+    return _hash.digest();
+  }
+
+ private:
+  utils::Xxh64 _hash;
+  std::uint32_t _hashedPos{0};
+};
+
+struct DatFileBlock {
+  const DatFileHuffmanTreeSymbol& huffmanTreeSymbol;
+  const DatFileHuffmanTreeCopy& huffmanTreeCopy;
+  std::uint16_t writeSizeConstAdd;
+  bool needsExtraRefills;
+  std::uint32_t maxCount;
+};
+
+// Huffman trees of the current block, unused when they come from the cache
+struct DatFileBlockTrees {
+  DatFileHuffmanTreeSymbol localHuffmanTreeSymbol;
+  DatFileHuffmanTreeCopy localHuffmanTreeCopy;  // distance
+  std::shared_ptr<const DatFileHuffmanTreeSymbol> cachedHuffmanTreeSymbol;
+  std::shared_ptr<const DatFileHuffmanTreeCopy> cachedHuffmanTreeCopy;
+};
+
+// Returns the write size constant addition
+template <typename BitArrayType>
+std::uint16_t readDatFileHeader(BitArrayType& ioInputBitArray) {
+  std::uint8_t method;
+  ioInputBitArray.template read<4>(method);
+  // Reading the const write size addition value
+  ioInputBitArray.template drop<4>();
+  std::uint16_t aWriteSizeConstAdd;
+  ioInputBitArray.template read<4>(aWriteSizeConstAdd);
+  aWriteSizeConstAdd += 1;
+  ioInputBitArray.template drop<4>();
+  return aWriteSizeConstAdd;
+}
+
+// Reads the trees and the code count of the next block, std::nullopt when
+// the stream ends
+template <typename BitArrayType>
+Result<std::optional<DatFileBlock>> readDatFileBlock(
+    BitArrayType& ioInputBitArray,
+    DatFileHuffmanTreeBuilder& ioHuffmanTreeBuilder,
+    std::uint16_t iWriteSizeConstAdd, DatFileBlockTrees& ioTrees,
+    DatFileHuffmanTreeCache::Impl* ipCache) {
+  // Reading HuffmanTrees
+  Result<const DatFileHuffmanTreeSymbol*> aHuffmanTreeSymbol = readHuffmanTree(
+      ioInputBitArray, ioHuffmanTreeBuilder, sDatFileNbSymbols,
+      ioTrees.localHuffmanTreeSymbol, ipCache, ioTrees.cachedHuffmanTreeSymbol);
+  if (!aHuffmanTreeSymbol) {
+    return std::unexpected{aHuffmanTreeSymbol.error()};
+  }
+  if (*aHuffmanTreeSymbol == nullptr) {
+    return std::nullopt;
+  }
+
+  Result<const DatFileHuffmanTreeCopy*> aHuffmanTreeCopy = readHuffmanTree(
+      ioInputBitArray, ioHuffmanTreeBuilder, sDatFileNbCopySymbols,
+      ioTrees.localHuffmanTreeCopy, ipCache, ioTrees.cachedHuffmanTreeCopy);
+  if (!aHuffmanTreeCopy) {
+    return std::unexpected{aHuffmanTreeCopy.error()};
+  }
+  if (*aHuffmanTreeCopy == nullptr) {
+    return std::nullopt;
+  }
+
+  // Reading MaxCount
+  std::uint32_t aMaxCount;
+  ioInputBitArray.template read<4>(aMaxCount);
+  aMaxCount = (aMaxCount + 1) << 12;
+  ioInputBitArray.template drop<4>();
+
+  // A refill is enough for a symbol and its write size, then for a write
+  // offset and its additional bits, unless the trees have very long codes
+  return DatFileBlock{
+      **aHuffmanTreeSymbol, **aHuffmanTreeCopy, iWriteSizeConstAdd,
+      ((*aHuffmanTreeSymbol)->maxNbBits() + sDatFileMaxWriteSizeAddBits >
+       BitArrayType::sMinBitsAfterRefill) ||
+          ((*aHuffmanTreeCopy)->maxNbBits() + sDatFileMaxWriteOffsetAddBits >
+           BitArrayType::sMinBitsAfterRefill),
+      aMaxCount};
+}
+
+// Invalid codes and truncated input are only checked after a block
+template <typename BitArrayType>
+Result<void> checkDatFileBitArray(const BitArrayType& iInputBitArray) {
+  if (iInputBitArray.isCorrupted()) {
+    return std::unexpected{Error::kInvalidHuffmanCode};
+  }
+  if (iInputBitArray.readPastEnd()) {
+    return std::unexpected{Error::kUnexpectedEndOfInput};
+  }
+  return {};
+}
+
+// Room left in the output by the fast loops
+template <typename OutputType>
+constexpr std::uint32_t sDatFileFastOutputMargin =
+    sDatFileMaxWriteSize +
+    (OutputType::sHasSlack ? 0 : utils::sCopyMatchMaxOverrun);
+
+// kFast decodes without any check, the caller guarantees room in the block
+// for a literal run and in the output for a whole match, and that no write
+// offset can reach before the output. kFastCheckingOffsets only checks the
+// write offsets. kChecked checks everything.
+enum class DatFileTokenLoop {
+  kFast,
+  kFastCheckingOffsets,
+  kChecked,
+};
+
+// Decodes a token, a literal run or a match. The bit array is not checked:
+// reading past its end or invalid codes is detected after the block.
+// Always inlined so that interleaved streams keep their state in registers.
+template <DatFileTokenLoop sLoop, typename BitArrayType, typename OutputType>
+[[gnu::always_inline]] inline Result<void> inflateToken(
+    BitArrayType& ioInputBitArray, const DatFileBlock& iBlock,
+    std::uint32_t iEndCodeReadCount, std::uint32_t iOutputSize,
+    std::uint32_t& ioCodeReadCount, std::uint32_t& ioOutputPos,
+    OutputType& ioOutput) {
+  constexpr bool sIsChecked = sLoop == DatFileTokenLoop::kChecked;
+
+  ioInputBitArray.refill();
+
+  // Reading the next literals at once when they cannot overrun the block
+  // or the output, even with slack: the codes past the output are not read
+  if (!sIsChecked ||
+      ((iEndCodeReadCount - ioCodeReadCount >=
+        DatFileHuffmanTreeSymbol::sMaxNbLiterals) &&
+       (iOutputSize - ioOutputPos >=
+        DatFileHuffmanTreeSymbol::sMaxNbLiterals))) {
+    std::uint8_t aNbLiterals = iBlock.huffmanTreeSymbol.readLiterals(
+        ioInputBitArray, ioOutput.literals(ioOutputPos));
+    if (aNbLiterals != 0) {
+      ioOutput.addLiterals(aNbLiterals);
+      ioOutputPos += aNbLiterals;
+      ioCodeReadCount += aNbLiterals;
+      return {};
+    }
+  }
+
+  ++ioCodeReadCount;
+
+  // Reading next code
+  std::uint16_t aSymbol;
+  iBlock.huffmanTreeSymbol.readCode(ioInputBitArray, aSymbol);
+
+  if (aSymbol < 0x100) {
+    *ioOutput.literals(ioOutputPos) = static_cast<std::byte>(aSymbol);
+    ioOutput.addLiterals(1);
+    ++ioOutputPos;
+    return {};
+  }
+
+  // We are in copy mode !
+  // Reading the additional info to know the write size
+  aSymbol -= 0x100;
+
+  if (iBlock.needsExtraRefills) {
+    ioInputBitArray.refill();
+  }
+
+  const DatFileCopyDescriptor& aWriteSizeDescriptor =
+      sDatFileWriteSizeDescriptorArray[aSymbol];
+  std::uint32_t aWriteSize =
+      aWriteSizeDescriptor.base + iBlock.writeSizeConstAdd +
+      ioInputBitArray.peekVariable(aWriteSizeDescriptor.nbAddBits);
+  ioInputBitArray.consume(aWriteSizeDescriptor.nbAddBits);
+
+  // Reading the write offset
+  ioInputBitArray.refill();
+  iBlock.huffmanTreeCopy.readCode(ioInputBitArray, aSymbol);
+
+  if (iBlock.needsExtraRefills) {
+    ioInputBitArray.refill();
+  }
+
+  const DatFileCopyDescriptor& aWriteOffsetDescriptor =
+      sDatFileWriteOffsetDescriptorArray[aSymbol];
+  std::uint32_t aWriteOffset =
+      aWriteOffsetDescriptor.base +
+      ioInputBitArray.peekVariable(aWriteOffsetDescriptor.nbAddBits);
+  ioInputBitArray.consume(aWriteOffsetDescriptor.nbAddBits);
+
+  if (sLoop != DatFileTokenLoop::kFast && aWriteOffset > ioOutputPos)
+      [[unlikely]] {
+    return std::unexpected{Error::kInvalidWriteOffset};
+  }
+
+  if constexpr (sIsChecked) {
+    aWriteSize = std::min(aWriteSize, iOutputSize - ioOutputPos);
+  }
+
+  ioOutput.template addMatch<sIsChecked>(ioOutputPos, aWriteOffset, aWriteSize,
+                                         iOutputSize);
+  ioOutputPos += aWriteSize;
+  return {};
+}
+
+// Decodes tokens until iEndCodeReadCount codes are read or iEndOutputPos is
+// reached
+template <DatFileTokenLoop sLoop, typename BitArrayType, typename OutputType>
+Result<void> inflateTokensImpl(BitArrayType& ioInputBitArray,
+                               const DatFileBlock& iBlock,
+                               std::uint32_t iEndCodeReadCount,
+                               std::uint32_t iEndOutputPos,
+                               std::uint32_t iOutputSize,
+                               std::uint32_t& ioCodeReadCount,
+                               std::uint32_t& ioOutputPos,
+                               OutputType& ioOutput) {
+  std::uint32_t aCurrentCodeReadCount = ioCodeReadCount;
+  std::uint32_t anOutputPos = ioOutputPos;
+
+  while ((aCurrentCodeReadCount < iEndCodeReadCount) &&
+         (anOutputPos < iEndOutputPos)) {
+    Result<void> aResult = inflateToken<sLoop>(
+        ioInputBitArray, iBlock, iEndCodeReadCount, iOutputSize,
+        aCurrentCodeReadCount, anOutputPos, ioOutput);
+    if (!aResult) [[unlikely]] {
+      return aResult;
+    }
+  }
+
+  ioCodeReadCount = aCurrentCodeReadCount;
+  ioOutputPos = anOutputPos;
+  return {};
+}
+
+// inflateTokensImpl compiled for the CPU tier in use
+template <DatFileTokenLoop sLoop, typename BitArrayType, typename OutputType>
+Result<void> inflateTokens(BitArrayType& ioInputBitArray,
+                           const DatFileBlock& iBlock,
+                           std::uint32_t iEndCodeReadCount,
+                           std::uint32_t iEndOutputPos,
+                           std::uint32_t iOutputSize,
+                           std::uint32_t& ioCodeReadCount,
+                           std::uint32_t& ioOutputPos, OutputType& ioOutput) {
+  return utils::callKernel([&] {
+    return inflateTokensImpl<sLoop>(ioInputBitArray, iBlock, iEndCodeReadCount,
+                                    iEndOutputPos, iOutputSize,
+                                    ioCodeReadCount, ioOutputPos, ioOutput);
+  });
 }
 
-static DatFileHuffmanTreeDictStaticInitializer
-    aDatFileHuffmanTreeDictStaticInitializer(dat::sDatFileHuffmanTreeDict);
+// Decodes the blocks from the current one on, ioOutputPos being the position
+// of its output. OutputType receives the decoded tokens, one window of the
+// output after the other.
+template <typename OutputType>
+Result<void> inflateBlocks(DatFileBitArray& ioInputBitArray,
+                           std::uint16_t iWriteSizeConstAdd,
+                           std::uint32_t iOutputSize,
+                           std::uint32_t& ioOutputPos, OutputType& ioOutput,
+                           DatFileHuffmanTreeBuilder& ioHuffmanTreeBuilder,
+                           DatFileBlockTrees& ioTrees,
+                           DatFileHuffmanTreeCache::Impl* ipCache) {
+  std::uint32_t anOutputPos = ioOutputPos;
+
+  while (anOutputPos < iOutputSize) {
+    ioOutput.startBlock(ioInputBitArray, anOutputPos);
+
+    Result<std::optional<DatFileBlock>> aBlock =
+        readDatFileBlock(ioInputBitArray, ioHuffmanTreeBuilder,
+                         iWriteSizeConstAdd, ioTrees, ipCache);
+    if (!aBlock) {
+      return std::unexpected{aBlock.error()};
+    }
+    if (!*aBlock) {
+      break;
+    }
+
+    const std::uint32_t aFastEndCodeReadCount =
+        (*aBlock)->maxCount - (DatFileHuffmanTreeSymbol::sMaxNbLiterals - 1);
+    const std::uint32_t aFastEndOutputPos =
+        iOutputSize > sDatFileFastOutputMargin<OutputType>
+            ? iOutputSize - sDatFileFastOutputMargin<OutputType>
+            : 0;
+
+    std::uint32_t aCurrentCodeReadCount = 0;
+
+    while ((aCurrentCodeReadCount < (*aBlock)->maxCount) &&
+           (anOutputPos < iOutputSize)) {
+      const std::uint32_t aWindowEndPos = ioOutput.windowEndPos(iOutputSize);
+
+      Result<void> aResult =
+          inflateTokens<DatFileTokenLoop::kFastCheckingOffsets>(
+              ioInputBitArray, **aBlock, aFastEndCodeReadCount,
+              std::min({aFastEndOutputPos, sDatFileMaxWriteOffset,
+                        aWindowEndPos}),
+              iOutputSize, aCurrentCodeReadCount, anOutputPos, ioOutput);
+      if (aResult) {
+        aResult = inflateTokens<DatFileTokenLoop::kFast>(
+            ioInputBitArray, **aBlock, aFastEndCodeReadCount,
+            std::min(aFastEndOutputPos, aWindowEndPos), iOutputSize,
+            aCurrentCodeReadCount, anOutputPos, ioOutput);
+      }
+      if (aResult) {
+        aResult = inflateTokens<DatFileTokenLoop::kChecked>(
+            ioInputBitArray, **aBlock, (*aBlock)->maxCount, aWindowEndPos,
+            iOutputSize, aCurrentCodeReadCount, anOutputPos, ioOutput);
+      }
+      if (!aResult) {
+        return aResult;
+      }
+
+      ioOutput.endWindow(anOutputPos);
+      ioOutputPos = anOutputPos;
+    }
+
+    Result<void> aResult = checkDatFileBitArray(ioInputBitArray);
+    if (!aResult) {
+      return aResult;
+    }
+
+    ioInputBitArray.refill();
+  }
+
+  return checkDatFileBitArray(ioInputBitArray);
+}
+
+template <typename OutputType>
+Result<void> inflatedata(DatFileBitArray& ioInputBitArray,
+                         std::uint32_t iOutputSize, OutputType& ioOutput,
+                         DatFileHuffmanTreeCache::Impl* ipCache) {
+  const std::uint16_t aWriteSizeConstAdd = readDatFileHeader(ioInputBitArray);
+
+  DatFileBlockTrees aTrees;
+  DatFileHuffmanTreeBuilder aHuffmanTreeBuilder;
+
+  std::uint32_t anOutputPos = 0;
+  return inflateBlocks(ioInputBitArray, aWriteSizeConstAdd, iOutputSize,
+                       anOutputPos, ioOutput, aHuffmanTreeBuilder, aTrees,
+                       ipCache);
+}
+
+static_assert(sDatFileOutputSlack >= utils::sCopyMatchMaxOverrun &&
+              sDatFileOutputSlack >= DatFileHuffmanTreeSymbol::sMaxNbLiterals);
+
+// Output bytes covered by a chunk of tokens of the pipelined inflate
+static constexpr std::uint32_t sDatFileTokenChunkSize = 1 << 16;
+// Chunks decoded ahead of the materialization
+static constexpr std::size_t sDatFileTokenQueueCapacity = 8;
+
+// A match preceded by nbLiterals literals
+struct DatFileToken {
+  std::uint32_t nbLiterals;
+  std::uint32_t writeOffset;
+  std::uint32_t writeSize;
+};
+
+// Tokens of the output from outputPos on. The literals not preceding a match
+// end the chunk. Each token writes at least one byte and the chunk ends at
+// the first one ending sDatFileTokenChunkSize bytes after outputPos.
+struct DatFileTokenChunk {
+  std::uint32_t outputPos{0};
+  std::uint32_t nbTokens{0};
+  std::uint32_t nbLiterals{0};
+  std::unique_ptr<DatFileToken[]> tokenTab{
+      std::make_unique_for_overwrite<DatFileToken[]>(sDatFileTokenChunkSize)};
+  // readLiterals() writes up to sMaxNbLiterals literals at once
+  std::unique_ptr<std::byte[]> literalTab{
+      std::make_unique_for_overwrite<std::byte[]>(
+          sDatFileTokenChunkSize + DatFileHuffmanTreeSymbol::sMaxNbLiterals)};
+};
+
+using DatFileTokenQueue =
+    utils::BoundedQueue<std::unique_ptr<DatFileTokenChunk>,
+                        sDatFileTokenQueueCapacity>;
+// Holds every chunk: queued, being filled, being materialized
+using DatFileTokenFreeQueue =
+    utils::BoundedQueue<std::unique_ptr<DatFileTokenChunk>,
+                        sDatFileTokenQueueCapacity + 2>;
+
+// Records the decoded tokens by chunks, queued for the materialization
+class DatFileTokenOutput {
+ public:
+  // Tokens are only recorded, literals do not go past the output either
+  static constexpr bool sHasSlack = false;
+
+  DatFileTokenOutput(DatFileTokenQueue& ioTokenQueue,
+                     DatFileTokenFreeQueue& ioFreeQueue)
+      : _tokenQueue(ioTokenQueue), _freeQueue(ioFreeQueue) {
+    startChunk(0);
+  }
+
+  std::byte* literals(std::uint32_t) {
+    return &_pChunk->literalTab[_pChunk->nbLiterals];
+  }
+  void addLiterals(std::uint32_t iNbLiterals) {
+    _pChunk->nbLiterals += iNbLiterals;
+  }
+
+  template <bool sIsChecked>
+  void addMatch(std::uint32_t, std::uint32_t iWriteOffset,
+                std::uint32_t iWriteSize, std::uint32_t) {
+    _pChunk->tokenTab[_pChunk->nbTokens] = {
+        _pChunk->nbLiterals - _nbLiteralsBeforeToken, iWriteOffset,
+        iWriteSize};
+    ++_pChunk->nbTokens;
+    _nbLiteralsBeforeToken = _pChunk->nbLiterals;
+  }
+
+  std::uint32_t windowEndPos(std::uint32_t iOutputSize) const {
+    return _pChunk->outputPos +
+           std::min(iOutputSize - _pChunk->outputPos, sDatFileTokenChunkSize);
+  }
+  void endWindow(std::uint32_t iOutputPos) {
+    if (iOutputPos - _pChunk->outputPos >= sDatFileTokenChunkSize) {
+      _tokenQueue.push(std::move(_pChunk));
+      startChunk(iOutputPos);
+    }
+  }
+
+  void startBlock(const DatFileBitArray&, std::uint32_t) {}
+
+  // Queues the last chunk
+  void finish() { _tokenQueue.push(std::move(_pChunk)); }
+
+ private:
+  void startChunk(std::uint32_t iOutputPos) {
+    std::optional<std::unique_ptr<DatFileTokenChunk>> aFreeChunk =
+        _freeQueue.tryPop();
+    _pChunk = aFreeChunk ? std::move(*aFreeChunk)
+                         : std::make_unique<DatFileTokenChunk>();
+    _pChunk->outputPos = iOutputPos;
+    _pChunk->nbTokens = 0;
+    _pChunk->nbLiterals = 0;
+    _nbLiteralsBeforeToken = 0;
+  }
+
+  DatFileTokenQueue& _tokenQueue;
+  DatFileTokenFreeQueue& _freeQueue;
+  std::unique_ptr<DatFileTokenChunk> _pChunk;
+  std::uint32_t _nbLiteralsBeforeToken;
+};
+
+// Writes the output of a chunk, its tokens being valid
+void materializeTokens(const DatFileTokenChunk& iChunk,
+                       std::byte* ioOutputTab, std::uint32_t iOutputSize) {
+  std::uint32_t anOutputPos = iChunk.outputPos;
+  const std::byte* pLiterals = iChunk.literalTab.get();
+
+  for (std::uint32_t i = 0; i < iChunk.nbTokens; ++i) {
+    const DatFileToken& aToken = iChunk.tokenTab[i];
+
+    std::memcpy(&ioOutputTab[anOutputPos], pLiterals, aToken.nbLiterals);
+    pLiterals += aToken.nbLiterals;
+    anOutputPos += aToken.nbLiterals;
+
+    copyDatFileMatchChecked(ioOutputTab, anOutputPos, aToken.writeOffset,
+                            aToken.writeSize, iOutputSize);
+    anOutputPos += aToken.writeSize;
+  }
+
+  std::memcpy(&ioOutputTab[anOutputPos], pLiterals,
+              iChunk.nbLiterals - (pLiterals - iChunk.literalTab.get()));
+}
+
+// Entries inflated together by inflateDatFileBuffers()
+static constexpr std::size_t sDatFileNbInterleavedStreams = 2;
+
+// State of an entry inflated by inflateDatFileBuffers()
+struct DatFileStream {
+  explicit DatFileStream(DatFileBufferBatchEntry& ioEntry)
+      : entry(ioEntry),
+        bitArray(ioEntry.inputTab),
+        output(ioEntry.outputTab.data()),
+        outputSize(ioEntry.outputTab.size()),
+        writeSizeConstAdd(readDatFileHeader(bitArray)) {}
+
+  // Whether the next token can be decoded by inflateTokensInterleaved()
+  bool isInFastRange() const {
+    return (codeReadCount < fastEndCodeReadCount) &&
+           (outputPos < fastEndOutputPos);
+  }
+
+  DatFileBufferBatchEntry& entry;
+  DatFileBitArray bitArray;
+  DatFileBufferOutput<false> output;
+  std::uint32_t outputSize;
+  std::uint32_t outputPos{0};
+  std::uint16_t writeSizeConstAdd;
+  DatFileBlockTrees trees;
+  std::optional<DatFileBlock> block;
+  std::uint32_t codeReadCount{0};
+  std::uint32_t fastEndCodeReadCount{0};
+  std::uint32_t fastEndOutputPos{0};
+  // Error met by inflateTokensInterleaved()
+  Result<void> result;
+};
+
+// Decodes a stream on its own until its current block has a fast range left,
+// or until it is inflated, which sets the result of its entry.
+// Returns whether the stream is not inflated yet.
+bool advanceDatFileStream(DatFileStream& ioStream,
+                          DatFileHuffmanTreeBuilder& ioHuffmanTreeBuilder,
+                          DatFileHuffmanTreeCache::Impl* ipCache) {
+  Result<void> aResult = ioStream.result;
+
+  while (aResult) {
+    if (ioStream.block) {
+      aResult = inflateTokens<DatFileTokenLoop::kChecked>(
+          ioStream.bitArray, *ioStream.block, ioStream.block->maxCount,
+          ioStream.outputSize, ioStream.outputSize, ioStream.codeReadCount,
+          ioStream.outputPos, ioStream.output);
+      if (aResult) {
+        aResult = checkDatFileBitArray(ioStream.bitArray);
+      }
+      if (!aResult) {
+        break;
+      }
+      ioStream.bitArray.refill();
+      ioStream.block.reset();
+    }
+
+    if (ioStream.outputPos >= ioStream.outputSize) {
+      aResult = checkDatFileBitArray(ioStream.bitArray);
+      break;
+    }
+
+    Result<std::optional<DatFileBlock>> aBlock =
+        readDatFileBlock(ioStream.bitArray, ioHuffmanTreeBuilder,
+                         ioStream.writeSizeConstAdd, ioStream.trees, ipCache);
+    if (!aBlock) {
+      aResult = std::unexpected{aBlock.error()};
+      break;
+    }
+    if (!*aBlock) {
+      aResult = checkDatFileBitArray(ioStream.bitArray);
+      break;
+    }
+
+    constexpr std::uint32_t sFastOutputMargin =
+        sDatFileFastOutputMargin<DatFileBufferOutput<false>>;
+
+    ioStream.block.emplace(**aBlock);
+    ioStream.codeReadCount = 0;
+    ioStream.fastEndCodeReadCount =
+        ioStream.block->maxCount -
+        (DatFileHuffmanTreeSymbol::sMaxNbLiterals - 1);
+    ioStream.fastEndOutputPos = ioStream.outputSize > sFastOutputMargin
+                                    ? ioStream.outputSize - sFastOutputMargin
+                                    : 0;
+    if (ioStream.isInFastRange()) {
+      return true;
+    }
+  }
+
+  if (aResult) {
+    ioStream.bitArray.drop<1>();
+    ioStream.entry.result = 0;
+  } else {
+    ioStream.entry.result = std::unexpected{aResult.error()};
+  }
+  return false;
+}
+
+// Decodes a token of each stream in turn while they all are in their fast
+// range, so that the dependency chains of the streams overlap. The hot state
+// of the streams is copied to locals, letting it live in registers.
+template <std::size_t sNbStreams>
+void inflateTokensInterleaved(
+    const std::array<DatFileStream*, sDatFileNbInterleavedStreams>&
+        iStreamArray) {
+  [&]<std::size_t... sStreamIndexes>(
+      std::index_sequence<sStreamIndexes...>) {
+    std::array<DatFileBitArray, sNbStreams> aBitArrayArray{
+        iStreamArray[sStreamIndexes]->bitArray...};
+    std::array<DatFileBufferOutput<false>, sNbStreams> anOutputArray{
+        iStreamArray[sStreamIndexes]->output...};
+    std::array<DatFileBlock, sNbStreams> aBlockArray{
+        *iStreamArray[sStreamIndexes]->block...};
+    std::array<std::uint32_t, sNbStreams> aCodeReadCountArray{
+        iStreamArray[sStreamIndexes]->codeReadCount...};
+    std::array<std::uint32_t, sNbStreams> anOutputPosArray{
+        iStreamArray[sStreamIndexes]->outputPos...};
+    std::array<std::uint32_t, sNbStreams> aFastEndCodeReadCountArray{
+        iStreamArray[sStreamIndexes]->fastEndCodeReadCount...};
+    const std::array<std::uint32_t, sNbStreams> aFastEndOutputPosArray{
+        iStreamArray[sStreamIndexes]->fastEndOutputPos...};
+
+    auto anIsInFastRange = [&](std::size_t iStreamIndex) {
+      return (aCodeReadCountArray[iStreamIndex] <
+              aFastEndCodeReadCountArray[iStreamIndex]) &&
+             (anOutputPosArray[iStreamIndex] <
+              aFastEndOutputPosArray[iStreamIndex]);
+    };
+    // The output size only matters to the checked loop
+    auto anInflateToken = [&](std::size_t iStreamIndex) {
+      Result<void> aResult =
+          inflateToken<DatFileTokenLoop::kFastCheckingOffsets>(
+              aBitArrayArray[iStreamIndex], aBlockArray[iStreamIndex],
+              aFastEndCodeReadCountArray[iStreamIndex], 0,
+              aCodeReadCountArray[iStreamIndex],
+              anOutputPosArray[iStreamIndex], anOutputArray[iStreamIndex]);
+      // Keeping the first error, the stream may go on until the round ends
+      if (!aResult && iStreamArray[iStreamIndex]->result) [[unlikely]] {
+        iStreamArray[iStreamIndex]->result = aResult;
+        aFastEndCodeReadCountArray[iStreamIndex] = 0;
+      }
+    };
+
+    // Rounds during which no stream can leave its fast range, a token reading
+    // at most sMaxNbLiterals codes and writing at most sDatFileMaxWriteSize
+    // bytes. The fast ranges are only checked between these rounds.
+    auto aNbSafeRounds = [&](std::size_t iStreamIndex) {
+      return std::min((aFastEndCodeReadCountArray[iStreamIndex] -
+                       aCodeReadCountArray[iStreamIndex]) /
+                          DatFileHuffmanTreeSymbol::sMaxNbLiterals,
+                      (aFastEndOutputPosArray[iStreamIndex] -
+                       anOutputPosArray[iStreamIndex]) /
+                          sDatFileMaxWriteSize);
+    };
+
+    while ((anIsInFastRange(sStreamIndexes) && ...)) {
+      const std::uint32_t aNbRounds =
+          std::max(std::min({aNbSafeRounds(sStreamIndexes)...}), 1u);
+      for (std::uint32_t i = 0; i < aNbRounds; ++i) {
+        (anInflateToken(sStreamIndexes), ...);
+      }
+    }
+
+    ((iStreamArray[sStreamIndexes]->bitArray = aBitArrayArray[sStreamIndexes],
+      iStreamArray[sStreamIndexes]->codeReadCount =
+          aCodeReadCountArray[sStreamIndexes],
+      iStreamArray[sStreamIndexes]->outputPos =
+          anOutputPosArray[sStreamIndexes],
+      iStreamArray[sStreamIndexes]->fastEndCodeReadCount =
+          aFastEndCodeReadCountArray[sStreamIndexes]),
+     ...);
+  }(std::make_index_sequence<sNbStreams>{});
+}
+
+void inflateDatFileBuffers(std::span<DatFileBufferBatchEntry> ioEntries,
+                           DatFileHuffmanTreeCache::Impl* ipCache) {
+  using DatFileStreamSlot = std::optional<DatFileStream>;
+
+  auto pStreamSlotArray = std::make_unique<
+      std::array<DatFileStreamSlot, sDatFileNbInterleavedStreams>>();
+  std::array<DatFileStreamSlot*, sDatFileNbInterleavedStreams>
+      anActiveSlotArray;
+  std::size_t aNbActiveSlots = 0;
+
+  DatFileHuffmanTreeBuilder aHuffmanTreeBuilder;
+  std::size_t aNextEntryIndex = 0;
+
+  // Starts the next entries in ioSlot until one is not inflated on its own.
+  // Returns whether ioSlot holds a stream.
+  auto aStartNextEntry = [&](DatFileStreamSlot& ioSlot) {
+    ioSlot.reset();
+    while (aNextEntryIndex < ioEntries.size()) {
+      DatFileBufferBatchEntry& anEntry = ioEntries[aNextEntryIndex];
+      ++aNextEntryIndex;
+
+      if (anEntry.inputTab.empty()) {
+        anEntry.result = std::unexpected{Error::kInputBufferIsEmpty};
+        continue;
+      }
+      if (anEntry.outputTab.empty()) {
+        anEntry.result = std::unexpected{Error::kOutputBufferIsEmpty};
+        continue;
+      }
+
+      ioSlot.emplace(anEntry);
+      if (advanceDatFileStream(*ioSlot, aHuffmanTreeBuilder, ipCache)) {
+        return true;
+      }
+      ioSlot.reset();
+    }
+    return false;
+  };
+
+  for (DatFileStreamSlot& aSlot : *pStreamSlotArray) {
+    if (aStartNextEntry(aSlot)) {
+      anActiveSlotArray[aNbActiveSlots] = &aSlot;
+      ++aNbActiveSlots;
+    }
+  }
+
+  while (aNbActiveSlots != 0) {
+    std::array<DatFileStream*, sDatFileNbInterleavedStreams> aStreamArray;
+    for (std::size_t i = 0; i < aNbActiveSlots; ++i) {
+      aStreamArray[i] = &**anActiveSlotArray[i];
+    }
+
+    switch (aNbActiveSlots) {
+      case 2:
+        inflateTokensInterleaved<2>(aStreamArray);
+        break;
+      default:
+        inflateTokensInterleaved<1>(aStreamArray);
+        break;
+    }
+
+    // Taking the streams out of their fast range through the rest of their
+    // block, replacing the inflated ones by the next entries
+    std::size_t i = 0;
+    while (i < aNbActiveSlots) {
+      DatFileStreamSlot& aSlot = *anActiveSlotArray[i];
+      if (aSlot->isInFastRange() ||
+          advanceDatFileStream(*aSlot, aHuffmanTreeBuilder, ipCache) ||
+          aStartNextEntry(aSlot)) {
+        ++i;
+        continue;
+      }
+      --aNbActiveSlots;
+      anActiveSlotArray[i] = anActiveSlotArray[aNbActiveSlots];
+    }
+  }
+}
+
+// DatInflater reads its input as the fragments between the framing words
+using DatFileStreamBitArray = utils::BitArray<std::uint32_t>;
+
+// Bits read by a token at most
+static constexpr std::uint32_t sDatFileMaxTokenNbBits =
+    2 * sDatFileMaxCodeBitsLength + sDatFileMaxWriteSizeAddBits +
+    sDatFileMaxWriteOffsetAddBits;
+
+// Writes the tokens to a window holding the output from iWindowPos on,
+// followed by sDatFileOutputSlack writable bytes
+class DatFileWindowOutput {
+ public:
+  static constexpr bool sHasSlack = true;
+
+  DatFileWindowOutput(std::byte* ioWindowTab, std::uint32_t iWindowPos)
+      : _pWindowTab(ioWindowTab), _windowPos(iWindowPos) {}
+
+  std::byte* literals(std::uint32_t iOutputPos) {
+    return &_pWindowTab[iOutputPos - _windowPos];
+  }
+  void addLiterals(std::uint32_t) {}
+
+  template <bool sIsChecked>
+  void addMatch(std::uint32_t iOutputPos, std::uint32_t iWriteOffset,
+                std::uint32_t iWriteSize, std::uint32_t) {
+    utils::copyMatch(literals(iOutputPos), iWriteOffset, iWriteSize);
+  }
+
+  // The window holds the whole output left
+  std::uint32_t windowEndPos(std::uint32_t iOutputSize) const {
+    return iOutputSize;
+  }
+  void endWindow(std::uint32_t) {}
+
+  void startBlock(const DatFileBitArray&, std::uint32_t) {}
+
+ private:
+  std::byte* _pWindowTab;
+  std::uint32_t _windowPos;
+};
+
+// Window of DatInflater: the bytes the next matches can copy from, then the
+// output of a call to inflate()
+static constexpr std::uint32_t sDatInflaterWindowSize =
+    sDatFileMaxWriteOffset + DatInflater::sMaxOutputSize +
+    sDatFileMaxWriteSize + sDatFileOutputSlack;
+
+// Output decoded between two slides of a DatFileSlidingWindowOutput
+static constexpr std::uint32_t sDatFileSlidingWindowStep = 1 << 16;
+static constexpr std::uint32_t sDatFileSlidingWindowSize =
+    sDatFileMaxWriteOffset + sDatFileSlidingWindowStep +
+    sDatFileMaxWriteSize + sDatFileOutputSlack;
+
+// Writes the tokens to a window sliding along the output, only keeping the
+// bytes the next matches can copy from
+class DatFileSlidingWindowOutput {
+ public:
+  static constexpr bool sHasSlack = true;
+
+  DatFileSlidingWindowOutput()
+      : _pWindowTab(std::make_unique_for_overwrite<std::byte[]>(
+            sDatFileSlidingWindowSize)) {}
+
+  std::byte* literals(std::uint32_t iOutputPos) {
+    return &_pWindowTab[iOutputPos - _windowPos];
+  }
+  void addLiterals(std::uint32_t) {}
+
+  template <bool sIsChecked>
+  void addMatch(std::uint32_t iOutputPos, std::uint32_t iWriteOffset,
+                std::uint32_t iWriteSize, std::uint32_t) {
+    utils::copyMatch(literals(iOutputPos), iWriteOffset, iWriteSize);
+  }
+
+  std::uint32_t windowEndPos(std::uint32_t iOutputSize) const {
+    return _outputPos +
+           std::min(iOutputSize - _outputPos, sDatFileSlidingWindowStep);
+  }
+  void endWindow(std::uint32_t iOutputPos) {
+    _outputPos = iOutputPos;
+    if (_outputPos - _windowPos > sDatFileMaxWriteOffset) {
+      const std::uint32_t aNewWindowPos = _outputPos - sDatFileMaxWriteOffset;
+      std::memmove(_pWindowTab.get(), &_pWindowTab[aNewWindowPos - _windowPos],
+                   sDatFileMaxWriteOffset);
+      _windowPos = aNewWindowPos;
+    }
+  }
+
+  void startBlock(const DatFileBitArray&, std::uint32_t) {}
+
+ protected:
+  std::unique_ptr<std::byte[]> _pWindowTab;
+  // Output from _windowPos on, up to _outputPos
+  std::uint32_t _windowPos{0};
+  std::uint32_t _outputPos{0};
+};
+
+// Room a token starting before the end of a window may write past it
+static constexpr std::uint32_t sDatFileTokenMaxOverrun =
+    sDatFileMaxWriteSize + sDatFileOutputSlack;
+
+// Non-empty output segment of a DatFileSegmentedOutput
+struct DatFileOutputSegment {
+  std::byte* data;
+  // Output positions of its first byte and past its last one
+  std::uint32_t pos;
+  std::uint32_t endPos;
+};
+
+// Writes the tokens straight into successive output segments. The tokens
+// close to the end of a segment, which could overrun it, are written to an
+// edge buffer instead, then split between the segments.
+class DatFileSegmentedOutput {
+ public:
+  static constexpr bool sHasSlack = true;
+
+  DatFileSegmentedOutput(std::span<const std::span<std::byte>> iSegmentTab,
+                         std::uint32_t iOutputSize)
+      : _pEdgeTab(std::make_unique_for_overwrite<std::byte[]>(
+            2 * sDatFileTokenMaxOverrun)) {
+    std::uint32_t aSegmentPos = 0;
+    for (std::span<std::byte> aSegment : iSegmentTab) {
+      if (!aSegment.empty()) {
+        const std::uint32_t aSegmentEndPos =
+            aSegmentPos + static_cast<std::uint32_t>(aSegment.size());
+        _segmentTab.push_back({aSegment.data(), aSegmentPos, aSegmentEndPos});
+        aSegmentPos = aSegmentEndPos;
+      }
+    }
+
+    // Blocks no larger than the average segment, so that fixed-size
+    // segments are found without a search
+    _blockShift = std::bit_width(iOutputSize / _segmentTab.size()) - 1;
+    _blockSegmentIndexTab.resize(((iOutputSize - 1) >> _blockShift) + 2);
+    std::uint32_t aSegmentIndex = 0;
+    for (std::size_t i = 0; i + 1 < _blockSegmentIndexTab.size(); ++i) {
+      while (_segmentTab[aSegmentIndex].endPos <= i << _blockShift) {
+        ++aSegmentIndex;
+      }
+      _blockSegmentIndexTab[i] = aSegmentIndex;
+    }
+    _blockSegmentIndexTab.back() =
+        static_cast<std::uint32_t>(_segmentTab.size() - 1);
+
+    startWindow();
+  }
+
+  std::byte* literals(std::uint32_t iOutputPos) {
+    return &_pWindowTab[iOutputPos - _windowPos];
+  }
+  void addLiterals(std::uint32_t) {}
+
+  template <bool sIsChecked>
+  void addMatch(std::uint32_t iOutputPos, std::uint32_t iWriteOffset,
+                std::uint32_t iWriteSize, std::uint32_t) {
+    if (iWriteOffset <= iOutputPos - _windowPos) {
+      utils::copyMatch(literals(iOutputPos), iWriteOffset, iWriteSize);
+      return;
+    }
+
+    // Source in a single segment before the window, with room for the
+    // overrun of the chunks read
+    const std::uint32_t aSourcePos = iOutputPos - iWriteOffset;
+    const DatFileOutputSegment& aSegment = findSegment(aSourcePos);
+    if (aSourcePos + iWriteSize <= _windowPos &&
+        aSegment.endPos - aSourcePos >=
+            iWriteSize + utils::sCopyMatchMaxOverrun) [[likely]] {
+      copyChunks(literals(iOutputPos),
+                 &aSegment.data[aSourcePos - aSegment.pos], iWriteSize);
+      return;
+    }
+    copyMatchAcrossSegments(iOutputPos, iWriteOffset, iWriteSize);
+  }
+
+  std::uint32_t windowEndPos(std::uint32_t iOutputSize) const {
+    return _outputPos + std::min(iOutputSize - _outputPos, _windowSize);
+  }
+  void endWindow(std::uint32_t iOutputPos) {
+    if (_pWindowTab == _pEdgeTab.get()) {
+      writeEdgeToSegments(iOutputPos);
+    }
+    _outputPos = iOutputPos;
+    startWindow();
+  }
+
+  void startBlock(const DatFileBitArray&, std::uint32_t) {}
+
+ private:
+  // Segment holding iOutputPos, before the end of the output
+  const DatFileOutputSegment& findSegment(std::uint32_t iOutputPos) const {
+    const std::size_t aBlockIndex = iOutputPos >> _blockShift;
+    auto aFirstSegment =
+        _segmentTab.begin() + _blockSegmentIndexTab[aBlockIndex];
+    auto aLastSegment =
+        _segmentTab.begin() + _blockSegmentIndexTab[aBlockIndex + 1];
+    while (aFirstSegment->endPos <= iOutputPos) {
+      // Several segments in the block
+      auto aMiddleSegment =
+          aFirstSegment + (aLastSegment - aFirstSegment + 1) / 2;
+      if (aMiddleSegment->pos <= iOutputPos) {
+        aFirstSegment = aMiddleSegment;
+      } else {
+        aLastSegment = aMiddleSegment - 1;
+      }
+    }
+    return *aFirstSegment;
+  }
+
+  // Writes to the segment when the window cannot overrun it, to the edge
+  // buffer otherwise
+  void startWindow() {
+    if (_outputPos == _segmentTab.back().endPos) {
+      return;
+    }
+    const DatFileOutputSegment& aSegment = findSegment(_outputPos);
+    if (aSegment.endPos - _outputPos > sDatFileTokenMaxOverrun) {
+      _pWindowTab = aSegment.data;
+      _windowPos = aSegment.pos;
+      _windowSize = aSegment.endPos - sDatFileTokenMaxOverrun - _outputPos;
+    } else {
+      _pWindowTab = _pEdgeTab.get();
+      _windowPos = _outputPos;
+      _windowSize = sDatFileTokenMaxOverrun;
+    }
+  }
+
+  void writeEdgeToSegments(std::uint32_t iOutputPos) {
+    for (std::uint32_t aPos = _outputPos; aPos != iOutputPos;) {
+      const DatFileOutputSegment& aSegment = findSegment(aPos);
+      const std::uint32_t aSize = std::min(iOutputPos, aSegment.endPos) - aPos;
+      std::memcpy(&aSegment.data[aPos - aSegment.pos],
+                  &_pEdgeTab[aPos - _outputPos], aSize);
+      aPos += aSize;
+    }
+  }
+
+  // Copies iSize bytes by chunks of utils::sCopyMatchChunkSize bytes, which
+  // may overrun both ranges
+  static void copyChunks(std::byte* ioDestination, const std::byte* iSource,
+                         std::uint32_t iSize) {
+    std::byte* const pDestinationEnd = ioDestination + iSize;
+    while (ioDestination < pDestinationEnd) {
+      std::memcpy(ioDestination, iSource, utils::sCopyMatchChunkSize);
+      ioDestination += utils::sCopyMatchChunkSize;
+      iSource += utils::sCopyMatchChunkSize;
+    }
+  }
+
+  // Copies a match starting before the window, range by range: no range
+  // crosses an edge or reaches the bytes it writes
+  void copyMatchAcrossSegments(std::uint32_t iOutputPos,
+                               std::uint32_t iWriteOffset,
+                               std::uint32_t iWriteSize) {
+    std::byte* pDestination = literals(iOutputPos);
+    std::uint32_t aSourcePos = iOutputPos - iWriteOffset;
+    while (iWriteSize != 0) {
+      const std::byte* pSource;
+      std::uint32_t aSize = std::min(iWriteSize, iWriteOffset);
+      if (aSourcePos >= _windowPos) {
+        pSource = literals(aSourcePos);
+      } else {
+        const DatFileOutputSegment& aSegment = findSegment(aSourcePos);
+        pSource = &aSegment.data[aSourcePos - aSegment.pos];
+        aSize = std::min(
+            aSize, std::min(_windowPos, aSegment.endPos) - aSourcePos);
+      }
+      std::memcpy(pDestination, pSource, aSize);
+      pDestination += aSize;
+      aSourcePos += aSize;
+      iWriteSize -= aSize;
+    }
+  }
+
+  std::vector<DatFileOutputSegment> _segmentTab;
+  // First segment of each block of 1 << _blockShift output bytes, then the
+  // last segment
+  std::vector<std::uint32_t> _blockSegmentIndexTab;
+  int _blockShift{0};
+  std::unique_ptr<std::byte[]> _pEdgeTab;
+  // Output from _windowPos on, up to _outputPos, then the current window
+  std::byte* _pWindowTab{nullptr};
+  std::uint32_t _windowPos{0};
+  std::uint32_t _outputPos{0};
+  std::uint32_t _windowSize{0};
+};
+
+inline bool isEmptyInput(std::span<const std::byte> iInputTab) {
+  return iInputTab.empty();
+}
+
+// The output positions are 32 bits
+inline bool isOutputTooLarge(std::size_t iOutputSize) {
+  return iOutputSize > std::numeric_limits<std::uint32_t>::max();
+}
+
+inline bool isEmptyInput(DatFileBitArray::FragmentTab iInputFragmentTab) {
+  return std::ranges::all_of(iInputFragmentTab,
+                             [](std::span<const std::byte> iFragment) {
+                               return iFragment.empty();
+                             });
+}
+
+// InputType is a buffer, or fragments of it
+template <bool sHasOutputSlack, typename InputType>
+Result<std::uint32_t> inflateDatFileBuffer(
+    InputType iInput, std::span<std::byte> ioOutputTab,
+    std::uint32_t iOutputSize, DatFileHuffmanTreeCache::Impl* ipCache) {
+  if (isEmptyInput(iInput)) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  if (iOutputSize == 0) {
+    return std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+
+  if (sHasOutputSlack &&
+      ioOutputTab.size() < std::size_t{iOutputSize} + sDatFileOutputSlack) {
+    return std::unexpected{Error::kOutputBufferTooSmall};
+  }
+
+  DatFileBitArray anInputBitArray(iInput);
+  DatFileBufferOutput<sHasOutputSlack> anOutput(ioOutputTab.data());
+
+  Result<void> aResult =
+      inflatedata(anInputBitArray, iOutputSize, anOutput, ipCache);
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+  anInputBitArray.drop<1>();
+
+  return 0;
+}
+
+Result<std::uint32_t> inflateDatFileBufferPipelined(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  if (isOutputTooLarge(ioOutputTab.size())) {
+    return std::unexpected{Error::kOutputBufferTooLarge};
+  }
+  const std::uint32_t anOutputSize = ioOutputTab.size();
+
+  // Not worth a thread
+  if (anOutputSize <= 2 * sDatFileTokenChunkSize) {
+    return inflateDatFileBuffer<false>(iInputTab, ioOutputTab, anOutputSize,
+                                       nullptr);
+  }
+
+  if (iInputTab.empty()) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  DatFileTokenQueue aTokenQueue;
+  DatFileTokenFreeQueue aFreeQueue;
+
+  std::thread aMaterializationThread([&] {
+    while (std::optional<std::unique_ptr<DatFileTokenChunk>> aChunk =
+               aTokenQueue.pop()) {
+      materializeTokens(**aChunk, ioOutputTab.data(), anOutputSize);
+      aFreeQueue.push(std::move(*aChunk));
+    }
+  });
+  // Closes the queue then joins the thread on every exit path, exceptions
+  // included, the thread waiting for chunks until then
+  struct MaterializationJoiner {
+    DatFileTokenQueue& tokenQueue;
+    std::thread& thread;
+    ~MaterializationJoiner() {
+      tokenQueue.close();
+      thread.join();
+    }
+  } aMaterializationJoiner{aTokenQueue, aMaterializationThread};
+
+  DatFileBitArray anInputBitArray(iInputTab);
+  DatFileTokenOutput anOutput(aTokenQueue, aFreeQueue);
+
+  Result<void> aResult =
+      inflatedata(anInputBitArray, anOutputSize, anOutput, nullptr);
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+  anOutput.finish();
+  anInputBitArray.drop<1>();
+
+  return 0;
+}
+
+Result<DatFileBufferInfo> inspectDatFileBuffer(
+    std::span<const std::byte> iInputTab, std::uint32_t iOutputSize) {
+  if (iInputTab.empty()) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  if (iOutputSize == 0) {
+    return std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+
+  DatFileBitArray anInputBitArray(iInputTab);
+  DatFileSlidingWindowOutput anOutput;
+  DatFileBlockTrees aTrees;
+  DatFileHuffmanTreeBuilder aHuffmanTreeBuilder;
+
+  const std::uint16_t aWriteSizeConstAdd = readDatFileHeader(anInputBitArray);
+  std::uint32_t anOutputPos = 0;
+  Result<void> aResult = inflateBlocks(
+      anInputBitArray, aWriteSizeConstAdd, iOutputSize, anOutputPos, anOutput,
+      aHuffmanTreeBuilder, aTrees, nullptr);
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+
+  return DatFileBufferInfo{anOutputPos, anInputBitArray.nbConsumedBytes()};
+}
+
+Result<std::uint32_t> peekDatFileBuffer(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+    DatFileHuffmanTreeBuilder& ioHuffmanTreeBuilder,
+    DatFileBlockTrees& ioTrees) {
+  if (iInputTab.empty()) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  if (ioOutputTab.empty()) {
+    return std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+  if (isOutputTooLarge(ioOutputTab.size())) {
+    return std::unexpected{Error::kOutputBufferTooLarge};
+  }
+
+  DatFileBitArray anInputBitArray(iInputTab);
+  DatFileBufferOutput<false> anOutput(ioOutputTab.data());
+
+  // Stopping at the end of the output, in the middle of its block
+  const std::uint16_t aWriteSizeConstAdd = readDatFileHeader(anInputBitArray);
+  std::uint32_t anOutputPos = 0;
+  Result<void> aResult = inflateBlocks(
+      anInputBitArray, aWriteSizeConstAdd, ioOutputTab.size(), anOutputPos,
+      anOutput, ioHuffmanTreeBuilder, ioTrees, nullptr);
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+
+  return anOutputPos;
+}
+
+Result<std::uint32_t> inflateDatFileBufferSegmented(
+    std::span<const std::byte> iInputTab,
+    std::span<const std::span<std::byte>> iOutputSegmentTab) {
+  if (iInputTab.empty()) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  std::size_t anOutputSize = 0;
+  for (std::span<std::byte> aSegment : iOutputSegmentTab) {
+    anOutputSize += aSegment.size();
+  }
+  if (anOutputSize == 0) {
+    return std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+  if (isOutputTooLarge(anOutputSize)) {
+    return std::unexpected{Error::kOutputBufferTooLarge};
+  }
+
+  DatFileBitArray anInputBitArray(iInputTab);
+  DatFileSegmentedOutput anOutput(iOutputSegmentTab,
+                                 static_cast<std::uint32_t>(anOutputSize));
+
+  Result<void> aResult = inflatedata(
+      anInputBitArray, static_cast<std::uint32_t>(anOutputSize), anOutput,
+      nullptr);
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+  anInputBitArray.drop<1>();
+
+  return 0;
+}
+
+Result<std::uint32_t> inflateDatFileBufferIndexed(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+    DatFileIndex& oIndex, std::uint32_t iCheckpointInterval) {
+  if (iInputTab.empty()) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  if (ioOutputTab.empty()) {
+    return std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+  if (isOutputTooLarge(ioOutputTab.size())) {
+    return std::unexpected{Error::kOutputBufferTooLarge};
+  }
+
+  oIndex.outputSize = ioOutputTab.size();
+  oIndex.checkpoints.clear();
+
+  DatFileBitArray anInputBitArray(iInputTab);
+  DatFileIndexingOutput anOutput(ioOutputTab.data(), iCheckpointInterval,
+                                 oIndex);
+
+  Result<void> aResult =
+      inflatedata(anInputBitArray, oIndex.outputSize, anOutput, nullptr);
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+  anInputBitArray.drop<1>();
+
+  return 0;
+}
+
+Result<HashedOutput> inflateDatFileBufferWithHash(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  if (iInputTab.empty()) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  if (ioOutputTab.empty()) {
+    return std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+  if (isOutputTooLarge(ioOutputTab.size())) {
+    return std::unexpected{Error::kOutputBufferTooLarge};
+  }
+
+  const std::uint32_t anOutputSize = ioOutputTab.size();
+
+  DatFileBitArray anInputBitArray(iInputTab);
+  DatFileHashingOutput anOutput(ioOutputTab.data());
+
+  Result<void> aResult =
+      inflatedata(anInputBitArray, anOutputSize, anOutput, nullptr);
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+
+  return HashedOutput{anOutputSize, anOutput.digest(anOutputSize)};
+}
+
+Result<std::uint32_t> inflateDatFileBufferVerified(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  if (iInputTab.empty()) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  if (ioOutputTab.empty()) {
+    return std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+  if (isOutputTooLarge(ioOutputTab.size())) {
+    return std::unexpected{Error::kOutputBufferTooLarge};
+  }
+
+  DatFileBitArray anInputBitArray(iInputTab, true);
+  DatFileBufferOutput<false> anOutput(ioOutputTab.data());
+
+  Result<void> aResult =
+      inflatedata(anInputBitArray, ioOutputTab.size(), anOutput, nullptr);
+  // Corrupted input is reported as such rather than as the decoding error it
+  // led to
+  if (anInputBitArray.hasChecksumMismatch()) {
+    return std::unexpected{Error::kChecksumMismatch};
+  }
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+
+  return 0;
+}
+
+// Serialized index: a magic number, the output size and the number of
+// checkpoints, then for each of them its input bit position, output position,
+// window size and window. Integers are little endian.
+static constexpr std::uint32_t sDatFileIndexMagic = 0x58444e49;  // "INDX"
+
+template <std::unsigned_integral IntType>
+void writeDatFileIndexValue(IntType iValue,
+                            std::vector<std::byte>& ioIndexTab) {
+  for (std::size_t i = 0; i < sizeof(IntType); ++i) {
+    ioIndexTab.push_back(static_cast<std::byte>(iValue >> (8 * i)));
+  }
+}
+
+template <std::unsigned_integral IntType>
+bool readDatFileIndexValue(std::span<const std::byte>& ioIndexTab,
+                           IntType& oValue) {
+  if (ioIndexTab.size() < sizeof(IntType)) {
+    return false;
+  }
+  oValue = 0;
+  for (std::size_t i = 0; i < sizeof(IntType); ++i) {
+    oValue |= static_cast<IntType>(ioIndexTab[i]) << (8 * i);
+  }
+  ioIndexTab = ioIndexTab.subspan(sizeof(IntType));
+  return true;
+}
+
+// The checkpoint must follow the one at iPreviousOutputPos, if any
+bool isValidDatFileCheckpoint(const DatFileCheckpoint& iCheckpoint,
+                              std::uint32_t iOutputSize,
+                              std::optional<std::uint32_t> iPreviousOutputPos) {
+  return (iCheckpoint.outputPos < iOutputSize) &&
+         (!iPreviousOutputPos || iCheckpoint.outputPos > *iPreviousOutputPos) &&
+         (iCheckpoint.windowTab.size() ==
+          std::min(iCheckpoint.outputPos, sDatFileMaxWriteOffset));
+}
+
+std::vector<std::byte> serializeDatFileIndex(const DatFileIndex& iIndex) {
+  std::vector<std::byte> anIndexTab;
+  writeDatFileIndexValue(sDatFileIndexMagic, anIndexTab);
+  writeDatFileIndexValue(iIndex.outputSize, anIndexTab);
+  writeDatFileIndexValue<std::uint32_t>(iIndex.checkpoints.size(), anIndexTab);
+  for (const DatFileCheckpoint& aCheckpoint : iIndex.checkpoints) {
+    writeDatFileIndexValue(aCheckpoint.inputBitPos, anIndexTab);
+    writeDatFileIndexValue(aCheckpoint.outputPos, anIndexTab);
+    writeDatFileIndexValue<std::uint32_t>(aCheckpoint.windowTab.size(),
+                                          anIndexTab);
+    anIndexTab.insert(anIndexTab.end(), aCheckpoint.windowTab.begin(),
+                      aCheckpoint.windowTab.end());
+  }
+  return anIndexTab;
+}
+
+Result<DatFileIndex> deserializeDatFileIndex(
+    std::span<const std::byte> iIndexTab) {
+  DatFileIndex anIndex;
+  std::uint32_t aMagic;
+  std::uint32_t aNbCheckpoints;
+  if (!readDatFileIndexValue(iIndexTab, aMagic) ||
+      (aMagic != sDatFileIndexMagic) ||
+      !readDatFileIndexValue(iIndexTab, anIndex.outputSize) ||
+      !readDatFileIndexValue(iIndexTab, aNbCheckpoints)) {
+    return std::unexpected{Error::kInvalidIndex};
+  }
+
+  std::optional<std::uint32_t> aPreviousOutputPos;
+  for (std::uint32_t i = 0; i < aNbCheckpoints; ++i) {
+    DatFileCheckpoint aCheckpoint;
+    std::uint32_t aWindowSize;
+    if (!readDatFileIndexValue(iIndexTab, aCheckpoint.inputBitPos) ||
+        !readDatFileIndexValue(iIndexTab, aCheckpoint.outputPos) ||
+        !readDatFileIndexValue(iIndexTab, aWindowSize) ||
+        (iIndexTab.size() < aWindowSize)) {
+      return std::unexpected{Error::kInvalidIndex};
+    }
+    aCheckpoint.windowTab.assign(iIndexTab.begin(),
+                                 iIndexTab.begin() + aWindowSize);
+    iIndexTab = iIndexTab.subspan(aWindowSize);
+
+    if (!isValidDatFileCheckpoint(aCheckpoint, anIndex.outputSize,
+                                  aPreviousOutputPos)) {
+      return std::unexpected{Error::kInvalidIndex};
+    }
+    aPreviousOutputPos = aCheckpoint.outputPos;
+    anIndex.checkpoints.push_back(std::move(aCheckpoint));
+  }
+
+  if (!iIndexTab.empty()) {
+    return std::unexpected{Error::kInvalidIndex};
+  }
+  return anIndex;
+}
+
+Result<std::uint32_t> inflateDatFileRange(std::span<const std::byte> iInputTab,
+                                          const DatFileIndex& iIndex,
+                                          std::uint32_t iRangePos,
+                                          std::span<std::byte> ioOutputTab) {
+  if (iInputTab.empty()) {
+    return std::unexpected{Error::kInputBufferIsEmpty};
+  }
+
+  if (ioOutputTab.empty()) {
+    return std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+
+  if (std::uint64_t{iRangePos} + ioOutputTab.size() > iIndex.outputSize) {
+    return std::unexpected{Error::kInvalidRange};
+  }
+
+  // Last checkpoint before the range
+  auto aCheckpointIt = std::ranges::upper_bound(
+      iIndex.checkpoints, iRangePos, {}, &DatFileCheckpoint::outputPos);
+  if (aCheckpointIt == iIndex.checkpoints.begin()) {
+    return std::unexpected{Error::kInvalidIndex};
+  }
+  const DatFileCheckpoint& aCheckpoint = *std::prev(aCheckpointIt);
+  if (!isValidDatFileCheckpoint(aCheckpoint, iIndex.outputSize,
+                                std::nullopt)) {
+    return std::unexpected{Error::kInvalidIndex};
+  }
+
+  // Output from the window of the checkpoint to the end of the range
+  const std::uint32_t aWindowPos =
+      aCheckpoint.outputPos - aCheckpoint.windowTab.size();
+  const std::uint32_t anEndOutputPos = iRangePos + ioOutputTab.size();
+  std::vector<std::byte> aWindowTab(anEndOutputPos - aWindowPos +
+                                    sDatFileOutputSlack);
+  std::ranges::copy(aCheckpoint.windowTab, aWindowTab.begin());
+
+  DatFileBitArray anInputBitArray(iInputTab);
+  const std::uint16_t aWriteSizeConstAdd = readDatFileHeader(anInputBitArray);
+  anInputBitArray.seek(aCheckpoint.inputBitPos);
+
+  DatFileWindowOutput anOutput(aWindowTab.data(), aWindowPos);
+  DatFileBlockTrees aTrees;
+  DatFileHuffmanTreeBuilder aHuffmanTreeBuilder;
+  std::uint32_t anOutputPos = aCheckpoint.outputPos;
+
+  Result<void> aResult = inflateBlocks(
+      anInputBitArray, aWriteSizeConstAdd, anEndOutputPos, anOutputPos,
+      anOutput, aHuffmanTreeBuilder, aTrees, nullptr);
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
+
+  std::copy_n(&aWindowTab[iRangePos - aWindowPos], ioOutputTab.size(),
+              ioOutputTab.begin());
+  return anOutputPos > iRangePos ? anOutputPos - iRangePos : 0;
+}
+
+}  // namespace dat
+
+struct DatFileDecoderContext::Impl {
+  dat::DatFileHuffmanTreeBuilder huffmanTreeBuilder;
+  dat::DatFileBlockTrees trees;
+};
+
+DatFileDecoderContext::DatFileDecoderContext()
+    : _pImpl(std::make_unique<Impl>()) {}
+
+DatFileDecoderContext::~DatFileDecoderContext() = default;
+
+Result<std::uint32_t> inflateDatFileBuffer(std::span<const std::byte> iInputTab,
+                                           std::span<std::byte> ioOutputTab) {
+  return dat::inflateDatFileBuffer<false>(iInputTab, ioOutputTab,
+                                          ioOutputTab.size(), nullptr);
+}
+
+Result<std::uint32_t> inflateDatFileBuffer(std::span<const std::byte> iInputTab,
+                                           std::span<std::byte> ioOutputTab,
+                                           DatFileHuffmanTreeCache& ioCache) {
+  if (dat::isOutputTooLarge(ioOutputTab.size())) {
+    return std::unexpected{Error::kOutputBufferTooLarge};
+  }
+  return dat::inflateDatFileBuffer<false>(iInputTab, ioOutputTab,
+                                          ioOutputTab.size(),
+                                          ioCache._pImpl.get());
+}
+
+Result<std::uint32_t> inflateDatFileBufferWithSlack(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+    std::uint32_t iOutputSize) {
+  return dat::inflateDatFileBuffer<true>(iInputTab, ioOutputTab, iOutputSize,
+                                         nullptr);
+}
+
+Result<std::uint32_t> inflateDatFileBufferWithSlack(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab,
+    std::uint32_t iOutputSize, DatFileHuffmanTreeCache& ioCache) {
+  return dat::inflateDatFileBuffer<true>(iInputTab, ioOutputTab, iOutputSize,
+                                         ioCache._pImpl.get());
+}
+
+Result<std::uint32_t> inflateDatFileBuffer(
+    std::span<const std::span<const std::byte>> iInputFragmentTab,
+    std::span<std::byte> ioOutputTab) {
+  if (dat::isOutputTooLarge(ioOutputTab.size())) {
+    return std::unexpected{Error::kOutputBufferTooLarge};
+  }
+  return dat::inflateDatFileBuffer<false>(iInputFragmentTab, ioOutputTab,
+                                          ioOutputTab.size(), nullptr);
+}
+
+Result<std::uint32_t> inflateDatFileBuffer(
+    std::span<const std::byte> iInputTab,
+    std::span<const std::span<std::byte>> iOutputSegmentTab) {
+  return dat::inflateDatFileBufferSegmented(iInputTab, iOutputSegmentTab);
+}
+
+Result<std::uint32_t> inflateDatFileBuffer(std::span<const std::byte> iInputTab,
+                                           std::span<std::byte> ioOutputTab,
+                                           DatFileIndex& oIndex,
+                                           std::uint32_t iCheckpointInterval) {
+  return dat::inflateDatFileBufferIndexed(iInputTab, ioOutputTab, oIndex,
+                                          iCheckpointInterval);
+}
+
+Result<HashedOutput> inflateDatFileBufferWithHash(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  return dat::inflateDatFileBufferWithHash(iInputTab, ioOutputTab);
+}
+
+Result<std::uint32_t> inflateDatFileBufferVerified(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  return dat::inflateDatFileBufferVerified(iInputTab, ioOutputTab);
+}
+
+std::vector<std::byte> serializeDatFileIndex(const DatFileIndex& iIndex) {
+  return dat::serializeDatFileIndex(iIndex);
+}
+
+Result<DatFileIndex> deserializeDatFileIndex(
+    std::span<const std::byte> iIndexTab) {
+  return dat::deserializeDatFileIndex(iIndexTab);
+}
+
+Result<std::uint32_t> inflateDatFileRange(std::span<const std::byte> iInputTab,
+                                          const DatFileIndex& iIndex,
+                                          std::uint32_t iRangePos,
+                                          std::span<std::byte> ioOutputTab) {
+  return dat::inflateDatFileRange(iInputTab, iIndex, iRangePos, ioOutputTab);
+}
+
+Result<std::uint32_t> inflateDatFileBufferPipelined(
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  return dat::inflateDatFileBufferPipelined(iInputTab, ioOutputTab);
+}
+
+Result<std::uint32_t> peekDatFileBuffer(std::span<const std::byte> iInputTab,
+                                        std::span<std::byte> ioOutputTab,
+                                        DatFileDecoderContext& ioContext) {
+  return dat::peekDatFileBuffer(iInputTab, ioOutputTab,
+                                ioContext._pImpl->huffmanTreeBuilder,
+                                ioContext._pImpl->trees);
+}
+
+Result<DatFileBufferInfo> inspectDatFileBuffer(
+    std::span<const std::byte> iInputTab, std::uint32_t iOutputSize) {
+  return dat::inspectDatFileBuffer(iInputTab, iOutputSize);
+}
+
+void inflateDatFileBuffers(std::span<DatFileBufferBatchEntry> ioEntries) {
+  dat::inflateDatFileBuffers(ioEntries, nullptr);
+}
+
+void inflateDatFileBuffers(std::span<DatFileBufferBatchEntry> ioEntries,
+                           DatFileHuffmanTreeCache& ioCache) {
+  dat::inflateDatFileBuffers(ioEntries, ioCache._pImpl.get());
+}
+
+// Decodes step by step, a step being a header, a block header, a run of
+// tokens or the end of a block. A step reading past the end of the input
+// received so far is undone until more input comes.
+struct DatInflater::Impl {
+  enum class State {
+    kHeader,
+    kBlock,
+    kTokens,
+    kEnd,
+    kDone,
+  };
+
+  explicit Impl(std::uint32_t iOutputSize)
+      : outputSize(iOutputSize),
+        windowTab(std::make_unique_for_overwrite<std::byte[]>(
+            dat::sDatInflaterWindowSize)) {}
+
+  // Lists in fragmentTab the parts of iInputTab between its framing words,
+  // after the input kept by the previous call. iInputTab starts nbInputBytes
+  // bytes into the buffer.
+  void splitInput(std::span<const std::byte> iInputTab) {
+    using SkipPolicy = dat::DatFileSkipPolicy;
+    constexpr std::uint64_t sFirstSkippedPos =
+        SkipPolicy::sFirstSkippedWord * sizeof(std::uint32_t);
+    constexpr std::uint64_t sSkippedPosPeriod =
+        SkipPolicy::sSkippedWordPeriod * sizeof(std::uint32_t);
+
+    fragmentTab.assign(1, keptInputTab);
+    std::uint64_t anInputPos = nbInputBytes;
+    while (!iInputTab.empty()) {
+      // Start of the skipped word holding or following the next byte
+      std::uint64_t aSkippedPos = sFirstSkippedPos;
+      if (anInputPos >= sFirstSkippedPos) {
+        aSkippedPos += (anInputPos - sFirstSkippedPos) / sSkippedPosPeriod *
+                       sSkippedPosPeriod;
+        if (anInputPos >= aSkippedPos + sizeof(std::uint32_t)) {
+          aSkippedPos += sSkippedPosPeriod;
+        }
+      }
+
+      const bool anIsSkipped = anInputPos >= aSkippedPos;
+      const std::size_t aNbBytes = std::min<std::uint64_t>(
+          iInputTab.size(), anIsSkipped
+                                ? aSkippedPos + sizeof(std::uint32_t) -
+                                      anInputPos
+                                : aSkippedPos - anInputPos);
+      if (!anIsSkipped) {
+        fragmentTab.push_back(iInputTab.first(aNbBytes));
+      }
+      anInputPos += aNbBytes;
+      iInputTab = iInputTab.subspan(aNbBytes);
+    }
+  }
+
+  // Drops the first iNbBytes bytes of the fragments, keeping the ones left
+  // when iKeepsRest, and returns the bytes of iInputTab dropped
+  std::size_t consumeInput(std::span<const std::byte> iInputTab,
+                           std::size_t iNbBytes, bool iKeepsRest) {
+    if (iKeepsRest) {
+      std::vector<std::byte> aKeptInputTab;
+      for (std::span<const std::byte> aFragment : fragmentTab) {
+        const std::size_t aNbDroppedBytes =
+            std::min(iNbBytes, aFragment.size());
+        aKeptInputTab.insert(aKeptInputTab.end(),
+                             aFragment.begin() + aNbDroppedBytes,
+                             aFragment.end());
+        iNbBytes -= aNbDroppedBytes;
+      }
+      keptInputTab = std::move(aKeptInputTab);
+      return iInputTab.size();
+    }
+
+    if (iNbBytes <= keptInputTab.size()) {
+      keptInputTab.erase(keptInputTab.begin(),
+                         keptInputTab.begin() + iNbBytes);
+      return 0;
+    }
+    iNbBytes -= keptInputTab.size();
+    keptInputTab.clear();
+    for (std::size_t i = 1; i < fragmentTab.size(); ++i) {
+      if (iNbBytes <= fragmentTab[i].size()) {
+        return std::distance(iInputTab.data(),
+                             fragmentTab[i].data() + iNbBytes);
+      }
+      iNbBytes -= fragmentTab[i].size();
+    }
+    return 0;
+  }
+
+  // Returns false when the call must stop, the output being full or done
+  Result<bool> step(dat::DatFileStreamBitArray& ioInputBitArray,
+                    dat::DatFileWindowOutput& ioOutput,
+                    std::uint32_t iEndOutputPos) {
+    switch (state) {
+      case State::kHeader:
+        writeSizeConstAdd = dat::readDatFileHeader(ioInputBitArray);
+        state = State::kBlock;
+        return true;
+
+      case State::kBlock: {
+        if (outputPos >= outputSize) {
+          state = State::kEnd;
+          return true;
+        }
+        Result<std::optional<dat::DatFileBlock>> aBlock =
+            dat::readDatFileBlock(ioInputBitArray, huffmanTreeBuilder,
+                                  writeSizeConstAdd, trees, nullptr);
+        if (!aBlock) {
+          return std::unexpected{aBlock.error()};
+        }
+        if (!*aBlock) {
+          state = State::kEnd;
+          return true;
+        }
+        block.emplace(**aBlock);
+        codeReadCount = 0;
+        state = State::kTokens;
+        return true;
+      }
+
+      case State::kTokens:
+        return stepTokens(ioInputBitArray, ioOutput, iEndOutputPos);
+
+      case State::kEnd: {
+        Result<void> aResult = dat::checkDatFileBitArray(ioInputBitArray);
+        if (!aResult) {
+          return std::unexpected{aResult.error()};
+        }
+        state = State::kDone;
+        return false;
+      }
+
+      case State::kDone:
+        break;
+    }
+    return false;
+  }
+
+  // Decodes the tokens that the input received so far holds for sure, or a
+  // single one
+  Result<bool> stepTokens(dat::DatFileStreamBitArray& ioInputBitArray,
+                          dat::DatFileWindowOutput& ioOutput,
+                          std::uint32_t iEndOutputPos) {
+    if ((codeReadCount >= block->maxCount) || (outputPos >= outputSize)) {
+      Result<void> aResult = dat::checkDatFileBitArray(ioInputBitArray);
+      if (!aResult) {
+        return std::unexpected{aResult.error()};
+      }
+      ioInputBitArray.refill();
+      block.reset();
+      state = State::kBlock;
+      return true;
+    }
+    if (outputPos >= iEndOutputPos) {
+      return false;
+    }
+
+    // A token reads at least a code
+    std::uint32_t anEndCodeReadCount = block->maxCount;
+    if (!hasLastInput) {
+      const std::uint32_t aNbTokens = std::max<std::size_t>(
+          ioInputBitArray.nbBitsLeft() / dat::sDatFileMaxTokenNbBits, 1);
+      if (block->maxCount - codeReadCount > aNbTokens) {
+        anEndCodeReadCount = codeReadCount + aNbTokens;
+      }
+    }
+
+    constexpr std::uint32_t sFastOutputMargin =
+        dat::sDatFileFastOutputMargin<dat::DatFileWindowOutput>;
+    const std::uint32_t aFastEndCodeReadCount =
+        std::min(anEndCodeReadCount,
+                 block->maxCount -
+                     (dat::DatFileHuffmanTreeSymbol::sMaxNbLiterals - 1));
+    const std::uint32_t aFastEndOutputPos =
+        outputSize > sFastOutputMargin ? outputSize - sFastOutputMargin : 0;
+
+    Result<void> aResult =
+        dat::inflateTokens<dat::DatFileTokenLoop::kFastCheckingOffsets>(
+            ioInputBitArray, *block, aFastEndCodeReadCount,
+            std::min(aFastEndOutputPos, iEndOutputPos), outputSize,
+            codeReadCount, outputPos, ioOutput);
+    if (aResult) {
+      aResult = dat::inflateTokens<dat::DatFileTokenLoop::kChecked>(
+          ioInputBitArray, *block, anEndCodeReadCount, iEndOutputPos,
+          outputSize, codeReadCount, outputPos, ioOutput);
+    }
+    if (!aResult) {
+      return std::unexpected{aResult.error()};
+    }
+    return true;
+  }
+
+  Result<std::span<const std::byte>> inflate(
+      std::span<const std::byte> iInputTab) {
+    // The last match of a call may go past its end, the bytes after it are
+    // returned by the next call
+    const std::uint32_t anEndOutputPos =
+        returnedOutputPos + std::min(outputSize - returnedOutputPos,
+                                     DatInflater::sMaxOutputSize);
+    if (state == State::kDone) {
+      return takeOutput(anEndOutputPos);
+    }
+
+    // Keeping the bytes the next matches can copy from, the ones not returned
+    // yet being among them
+    if (outputPos - windowPos > dat::sDatFileMaxWriteOffset) {
+      const std::uint32_t aNewWindowPos =
+          outputPos - dat::sDatFileMaxWriteOffset;
+      std::memmove(windowTab.get(), &windowTab[aNewWindowPos - windowPos],
+                   dat::sDatFileMaxWriteOffset);
+      windowPos = aNewWindowPos;
+    }
+
+    // The input is read in place, as the fragments between its framing words
+    const bool anIsInputCut = iInputTab.size() > DatInflater::sMaxInputSize;
+    iInputTab = iInputTab.first(
+        std::min<std::size_t>(iInputTab.size(), DatInflater::sMaxInputSize));
+    hasLastInput = isLastInput && !anIsInputCut;
+    splitInput(iInputTab);
+
+    dat::DatFileStreamBitArray anInputBitArray{
+        dat::DatFileStreamBitArray::FragmentTab(fragmentTab)};
+    anInputBitArray.consume(inputBitPos);
+    anInputBitArray.refill();
+    if (isInputCorrupted) {
+      anInputBitArray.markCorrupted();
+    }
+    const std::size_t aNbInputBits = anInputBitArray.nbBitsLeft() + inputBitPos;
+
+    dat::DatFileWindowOutput anOutput(windowTab.get(), windowPos);
+
+    needsInput = false;
+    Result<void> aResult;
+    for (;;) {
+      const dat::DatFileStreamBitArray aSavedInputBitArray = anInputBitArray;
+      const State aSavedState = state;
+      const std::uint32_t aSavedCodeReadCount = codeReadCount;
+      const std::uint32_t aSavedOutputPos = outputPos;
+
+      Result<bool> aHasStepped =
+          step(anInputBitArray, anOutput, anEndOutputPos);
+
+      // Zero bits past the end may be behind the error as well
+      if (!hasLastInput && anInputBitArray.reachedEnd() &&
+          (!aHasStepped || anInputBitArray.readPastEnd() ||
+           anInputBitArray.isCorrupted())) {
+        anInputBitArray = aSavedInputBitArray;
+        if (aSavedState != State::kTokens) {
+          block.reset();
+        }
+        state = aSavedState;
+        codeReadCount = aSavedCodeReadCount;
+        outputPos = aSavedOutputPos;
+        // A cut input goes on with the next call
+        needsInput = !anIsInputCut;
+        break;
+      }
+      if (!aHasStepped) {
+        aResult = std::unexpected{aHasStepped.error()};
+        break;
+      }
+      if (!*aHasStepped) {
+        break;
+      }
+    }
+
+    const std::size_t aNbConsumedBits =
+        aNbInputBits - anInputBitArray.nbBitsLeft();
+    // The input left when it ran out is kept, the caller gives it again
+    // otherwise
+    nbConsumedInputBytes = consumeInput(
+        iInputTab, aNbConsumedBits / 32 * sizeof(std::uint32_t), needsInput);
+    nbInputBytes += nbConsumedInputBytes;
+    inputBitPos = aNbConsumedBits % 32;
+    isInputCorrupted = anInputBitArray.isCorrupted();
+
+    if (!aResult) {
+      return std::unexpected{aResult.error()};
+    }
+    return takeOutput(anEndOutputPos);
+  }
+
+  // Returns the output not returned yet, up to iEndOutputPos
+  std::span<const std::byte> takeOutput(std::uint32_t iEndOutputPos) {
+    const std::uint32_t aStartOutputPos = returnedOutputPos;
+    returnedOutputPos = std::min({outputPos, outputSize, iEndOutputPos});
+    return std::span<const std::byte>(
+        &windowTab[aStartOutputPos - windowPos],
+        returnedOutputPos - aStartOutputPos);
+  }
+
+  bool isDone() const {
+    return state == State::kDone &&
+           returnedOutputPos == std::min(outputPos, outputSize);
+  }
+
+  const std::uint32_t outputSize;
+  State state{State::kHeader};
+  Result<void> status;
+  bool isLastInput{false};
+  // Whether the input of the call ends the buffer
+  bool hasLastInput{false};
+  bool needsInput{false};
+
+  // Input kept without its framing words when a call ran out of it, decoding
+  // resumes inputBitPos bits into it, or into the next input when it is empty
+  std::vector<std::byte> keptInputTab;
+  std::uint8_t inputBitPos{0};
+  // Bytes of the buffer consumed so far, framing words included
+  std::uint64_t nbInputBytes{0};
+  std::size_t nbConsumedInputBytes{0};
+  std::vector<std::span<const std::byte>> fragmentTab;
+  // Invalid codes are only reported at the end of the block
+  bool isInputCorrupted{false};
+
+  std::uint16_t writeSizeConstAdd{0};
+  dat::DatFileHuffmanTreeBuilder huffmanTreeBuilder;
+  dat::DatFileBlockTrees trees;
+  std::optional<dat::DatFileBlock> block;
+  std::uint32_t codeReadCount{0};
+
+  // Output from windowPos on
+  std::unique_ptr<std::byte[]> windowTab;
+  std::uint32_t windowPos{0};
+  std::uint32_t outputPos{0};
+  std::uint32_t returnedOutputPos{0};
+};
+
+DatInflater::DatInflater(std::uint32_t iOutputSize)
+    : _pImpl(std::make_unique<Impl>(iOutputSize)) {}
+
+DatInflater::~DatInflater() = default;
+
+Result<std::span<const std::byte>> DatInflater::inflate(
+    std::span<const std::byte> iInputTab, bool iIsLastInput) {
+  if (!_pImpl->status) {
+    return std::unexpected{_pImpl->status.error()};
+  }
+
+  _pImpl->isLastInput = _pImpl->isLastInput || iIsLastInput;
+  _pImpl->nbConsumedInputBytes = 0;
+
+  if (_pImpl->isLastInput && _pImpl->nbInputBytes == 0 &&
+      iInputTab.empty()) {
+    _pImpl->status = std::unexpected{Error::kInputBufferIsEmpty};
+  } else if (_pImpl->outputSize == 0) {
+    _pImpl->status = std::unexpected{Error::kOutputBufferIsEmpty};
+  }
+  if (!_pImpl->status) {
+    return std::unexpected{_pImpl->status.error()};
+  }
+
+  Result<std::span<const std::byte>> anOutputTab = _pImpl->inflate(iInputTab);
+  if (!anOutputTab) {
+    _pImpl->status = std::unexpected{anOutputTab.error()};
+  }
+  return anOutputTab;
+}
+
+bool DatInflater::needsInput() const { return _pImpl->needsInput; }
+
+std::size_t DatInflater::nbConsumedInputBytes() const {
+  return _pImpl->nbConsumedInputBytes;
+}
+
+bool DatInflater::isDone() const {
+  return _pImpl->isDone();
+}
 
 }  // namespace gw2::compression
@@ -2,15 +2,36 @@
 
 #include <memory.h>
 
+#include <algorithm>
 #include <bit>
+#include <cstring>
 #include <utility>
 #include <vector>
 
-#include "HuffmanTreeUtils.hpp"
+#include "BitArray.hpp"
+#include "CpuDispatch.hpp"
+#include "HuffmanTree.hpp"
+#include "Xxh64.hpp"
 
 namespace gw2::compression {
 namespace texture {
 
+// The dictionary has 18 symbols with codes of at most 6 bits, a 64 entries
+// lookup table decodes any of them with a single probe
+static constexpr std::uint8_t sTextureDictNbBitsHash = 6;
+static constexpr std::uint8_t sTextureMaxCodeBitsLength = 7;
+static constexpr std::uint16_t sTextureMaxSymbolValue = 0x13;
+
+// Skipping four bytes every 65k chunk
+using TextureSkipPolicy = utils::EveryNWordsSkipPolicy<0x4000>;
+using TextureBitArray = utils::BitArray<std::uint32_t, TextureSkipPolicy>;
+using TextureHuffmanTreeDict =
+    HuffmanTree<std::uint16_t, sTextureDictNbBitsHash,
+                sTextureMaxCodeBitsLength, sTextureMaxSymbolValue>;
+using TextureHuffmanTreeBuilder =
+    HuffmanTreeBuilder<std::uint16_t, sTextureMaxCodeBitsLength,
+                       sTextureMaxSymbolValue>;
+
 struct Format {
   std::uint16_t flags;
   std::uint16_t pixelSizeInBits;
@@ -19,11 +40,15 @@ struct Format {
 struct FullFormat {
   Format format;
   std::uint32_t nbObPixelBlocks;
+  std::uint16_t width;
+  std::uint16_t height;
+};
+
+// Layout of the pixel blocks of a format
+struct FormatLayout {
   std::uint32_t bytesPerPixelBlock;
   std::uint32_t bytesPerComponent;
   bool hasTwoComponents;
-  std::uint16_t width;
-  std::uint16_t height;
 };
 
 enum FormatFlags {
@@ -34,6 +59,18 @@ enum FormatFlags {
   FF_BICOLORCOMP = 0x200
 };
 
+constexpr FormatLayout makeFormatLayout(Format iFormat) {
+  FormatLayout aLayout{};
+  aLayout.bytesPerPixelBlock = (iFormat.pixelSizeInBits * 4 * 4) / 8;
+  aLayout.hasTwoComponents =
+      ((iFormat.flags & (FF_PLAINCOMP | FF_COLOR | FF_ALPHA)) ==
+       (FF_PLAINCOMP | FF_COLOR | FF_ALPHA)) ||
+      (iFormat.flags & FF_BICOLORCOMP);
+  aLayout.bytesPerComponent =
+      aLayout.bytesPerPixelBlock / (aLayout.hasTwoComponents ? 2 : 1);
+  return aLayout;
+}
+
 enum CompressionFlags {
   CF_DECODE_WHITE_COLOR = 0x01,
   CF_DECODE_CONSTANT_ALPHA_FROM4BITS = 0x02,
@@ -42,149 +79,339 @@ enum CompressionFlags {
 };
 
 // Static Values
-HuffmanTree sHuffmanTreeDict;
-Format sFormats[9];
-bool sStaticValuesInitialized(false);
-
-void initializeStaticValues() {
-  // Formats
-  {
-    Format& aDxt1Format = sFormats[0];
-    aDxt1Format.flags = FF_COLOR | FF_ALPHA | FF_DEDUCEDALPHACOMP;
-    aDxt1Format.pixelSizeInBits = 4;
-
-    Format& aDxt2Format = sFormats[1];
-    aDxt2Format.flags = FF_COLOR | FF_ALPHA | FF_PLAINCOMP;
-    aDxt2Format.pixelSizeInBits = 8;
-
-    sFormats[2] = sFormats[1];
-    sFormats[3] = sFormats[1];
-    sFormats[4] = sFormats[1];
-
-    Format& aDxtAFormat = sFormats[5];
-    aDxtAFormat.flags = FF_ALPHA | FF_PLAINCOMP;
-    aDxtAFormat.pixelSizeInBits = 4;
-
-    Format& aDxtLFormat = sFormats[6];
-    aDxtLFormat.flags = FF_COLOR;
-    aDxtLFormat.pixelSizeInBits = 8;
-
-    Format& aDxtNFormat = sFormats[7];
-    aDxtNFormat.flags = FF_BICOLORCOMP;
-    aDxtNFormat.pixelSizeInBits = 8;
-
-    Format& a3dcxFormat = sFormats[8];
-    a3dcxFormat.flags = FF_BICOLORCOMP;
-    a3dcxFormat.pixelSizeInBits = 8;
-  }
-
-  std::int16_t aWorkingBitTab[MaxCodeBitsLength];
-  std::int16_t aWorkingCodeTab[MaxSymbolValue];
-
-  // Initialize our workingTabs
-  memset(&aWorkingBitTab, 0xFF, MaxCodeBitsLength * sizeof(std::int16_t));
-  memset(&aWorkingCodeTab, 0xFF, MaxSymbolValue * sizeof(std::int16_t));
-
-  fillWorkingTabsHelper(1, 0x01, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-
-  fillWorkingTabsHelper(2, 0x12, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-
-  fillWorkingTabsHelper(6, 0x11, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x10, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x0F, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x0E, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x0D, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x0C, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x0B, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x0A, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x09, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x08, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x07, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x06, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x05, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x04, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x03, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-  fillWorkingTabsHelper(6, 0x02, &aWorkingBitTab[0], &aWorkingCodeTab[0]);
-
-  return buildHuffmanTree(sHuffmanTreeDict, &aWorkingBitTab[0],
-                          &aWorkingCodeTab[0]);
+static constexpr Format sFormats[9] = {
+    {FF_COLOR | FF_ALPHA | FF_DEDUCEDALPHACOMP, 4},  // DXT1
+    {FF_COLOR | FF_ALPHA | FF_PLAINCOMP, 8},         // DXT2
+    {FF_COLOR | FF_ALPHA | FF_PLAINCOMP, 8},         // DXT3
+    {FF_COLOR | FF_ALPHA | FF_PLAINCOMP, 8},         // DXT4
+    {FF_COLOR | FF_ALPHA | FF_PLAINCOMP, 8},         // DXT5
+    {FF_ALPHA | FF_PLAINCOMP, 4},                    // DXTA
+    {FF_COLOR, 8},                                   // DXTL
+    {FF_BICOLORCOMP, 8},                             // DXTN
+    {FF_BICOLORCOMP, 8}                              // 3DCX
+};
+
+static constexpr TextureHuffmanTreeDict makeTextureHuffmanTreeDict() {
+  TextureHuffmanTreeDict aHuffmanTree{};
+  TextureHuffmanTreeBuilder aHuffmanTreeBuilder{};
+  aHuffmanTreeBuilder.clear();
+
+  aHuffmanTreeBuilder.addSymbol(0x01, 1);
+
+  aHuffmanTreeBuilder.addSymbol(0x12, 2);
+
+  aHuffmanTreeBuilder.addSymbols(0x11, 16, 6);  // 0x11 down to 0x02
+
+  aHuffmanTreeBuilder.buildHuffmanTree(aHuffmanTree);
+  return aHuffmanTree;
 }
 
-Format deduceFormat(std::uint32_t iFourCC) {
+static constexpr TextureHuffmanTreeDict sHuffmanTreeDict =
+    makeTextureHuffmanTreeDict();
+
+// Calls iFunction with the format of iFourCC as template argument, so that
+// each format gets its own decoding code
+template <typename Function>
+decltype(auto) visitFormat(std::uint32_t iFourCC, Function&& iFunction) {
   switch (iFourCC) {
     case 0x31545844:  // DXT1
-      return sFormats[0];
+      return iFunction.template operator()<sFormats[0]>();
 
     case 0x32545844:  // DXT2
-      return sFormats[1];
+      return iFunction.template operator()<sFormats[1]>();
 
     case 0x33545844:  // DXT3
-      return sFormats[2];
+      return iFunction.template operator()<sFormats[2]>();
 
     case 0x34545844:  // DXT4
-      return sFormats[3];
+      return iFunction.template operator()<sFormats[3]>();
 
     case 0x35545844:  // DXT5
-      return sFormats[4];
+      return iFunction.template operator()<sFormats[4]>();
 
     case 0x41545844:  // DXTA
-      return sFormats[5];
+      return iFunction.template operator()<sFormats[5]>();
 
     case 0x4C545844:  // DXTL
-      return sFormats[6];
+      return iFunction.template operator()<sFormats[6]>();
 
     case 0x4E545844:  // DXTN
-      return sFormats[7];
+      return iFunction.template operator()<sFormats[7]>();
 
     case 0x58434433:  // 3DCX
-      return sFormats[8];
+      return iFunction.template operator()<sFormats[8]>();
   }
   std::unreachable();
 }
 
-void decodeWhiteColor(State& ioState, std::vector<bool>& ioAlphaBitMap,
-                      std::vector<bool>& ioColorBitMap,
-                      const FullFormat& iFullFormat, std::byte* ioOutputTab) {
-  uint32_t aPixelBlockPos = 0;
+Format deduceFormat(std::uint32_t iFourCC) {
+  return visitFormat(iFourCC, []<Format sFormat> { return sFormat; });
+}
 
-  while (aPixelBlockPos < iFullFormat.nbObPixelBlocks) {
-    // Reading next code
-    std::uint16_t aCode = 0;
-    readCode(sHuffmanTreeDict, ioState, aCode);
+// Filled state of the pixel blocks, one bit per block and 64 blocks per word.
+// The bits past the last block are set, so that they are never looked for.
+class BlockBitmap {
+ public:
+  explicit BlockBitmap(std::uint32_t iNbBlocks)
+      : _wordTab((iNbBlocks + 63) / 64, 0) {
+    if (iNbBlocks % 64 != 0) {
+      _wordTab.back() = ~std::uint64_t{0} << (iNbBlocks % 64);
+    }
+  }
 
-    needBits(ioState, 1);
-    std::uint32_t aValue = readBits(ioState, 1);
-    dropBits(ioState, 1);
+  std::uint64_t& operator[](std::size_t iWordIndex) {
+    return _wordTab[iWordIndex];
+  }
 
-    while (aCode > 0) {
-      if (!ioColorBitMap[aPixelBlockPos]) {
-        if (aValue) {
-          *std::bit_cast<std::int64_t*>(&(
-              ioOutputTab[iFullFormat.bytesPerPixelBlock * (aPixelBlockPos)])) =
-              0xFFFFFFFFFFFFFFFE;
+  std::uint64_t operator[](std::size_t iWordIndex) const {
+    return _wordTab[iWordIndex];
+  }
 
-          ioAlphaBitMap[aPixelBlockPos] = true;
-          ioColorBitMap[aPixelBlockPos] = true;
-        }
-        --aCode;
+  std::size_t nbWords() const { return _wordTab.size(); }
+
+ private:
+  std::vector<std::uint64_t> _wordTab;
+};
+
+// Reads the words of a buffer given as fragments from iWordPos, straight
+// from the current fragment. The words split between two fragments are put
+// together byte by byte. Only the whole words of the buffer can be read.
+class WordReader {
+ public:
+  WordReader(std::span<const std::span<const std::byte>> iFragmentTab,
+             std::size_t iWordPos)
+      : _fragmentTab(iFragmentTab) {
+    std::size_t aPos = iWordPos * sizeof(std::uint32_t);
+    while (_fragmentIndex < _fragmentTab.size() &&
+           aPos >= _fragmentTab[_fragmentIndex].size()) {
+      aPos -= _fragmentTab[_fragmentIndex].size();
+      ++_fragmentIndex;
+    }
+    if (_fragmentIndex < _fragmentTab.size()) {
+      enterFragment();
+      _pPos += aPos;
+    }
+  }
+
+  std::uint32_t read() {
+    std::uint32_t aWord;
+    if (std::distance(_pPos, _pEndPos) >=
+        static_cast<std::ptrdiff_t>(sizeof(aWord))) [[likely]] {
+      std::memcpy(&aWord, _pPos, sizeof(aWord));
+      _pPos += sizeof(aWord);
+    } else {
+      readSlow(reinterpret_cast<std::byte*>(&aWord), sizeof(aWord));
+    }
+    return aWord;
+  }
+
+ private:
+  void enterFragment() {
+    _pPos = _fragmentTab[_fragmentIndex].data();
+    _pEndPos = _pPos + _fragmentTab[_fragmentIndex].size();
+  }
+
+  void readSlow(std::byte* oBytes, std::size_t iSize) {
+    while (iSize != 0) {
+      if (_pPos == _pEndPos) {
+        ++_fragmentIndex;
+        enterFragment();
+        continue;
       }
-      ++aPixelBlockPos;
+      const std::size_t aSize =
+          std::min<std::size_t>(iSize, std::distance(_pPos, _pEndPos));
+      std::memcpy(oBytes, _pPos, aSize);
+      _pPos += aSize;
+      oBytes += aSize;
+      iSize -= aSize;
     }
+  }
+
+  std::span<const std::span<const std::byte>> _fragmentTab;
+  std::size_t _fragmentIndex{0};
+  const std::byte* _pPos{nullptr};
+  const std::byte* _pEndPos{nullptr};
+};
 
-    while (aPixelBlockPos < iFullFormat.nbObPixelBlocks &&
-           ioColorBitMap[aPixelBlockPos]) {
-      ++aPixelBlockPos;
+// Writes iValue at iOffset in the blocks iFirstBlockPos + k, for each bit k
+// set in iMask. The constant components are at least 8 bytes long. Following
+// blocks are written together, 16 bytes at a time when they are contiguous.
+template <std::uint32_t sBytesPerPixelBlock>
+void fillBlocks(std::byte* ioOutputTab, std::size_t iFirstBlockPos,
+                std::uint64_t iMask, std::uint32_t iOffset,
+                std::uint64_t iValue) {
+  const std::uint64_t aPatternTab[2] = {iValue, iValue};
+
+  while (iMask != 0) {
+    const std::uint32_t aFirstBit = std::countr_zero(iMask);
+    std::uint32_t aNbBlocks = std::countr_one(iMask >> aFirstBit);
+    iMask = aFirstBit + aNbBlocks == 64
+                ? 0
+                : iMask & (~std::uint64_t{0} << (aFirstBit + aNbBlocks));
+
+    std::byte* aPos = ioOutputTab +
+                      sBytesPerPixelBlock * (iFirstBlockPos + aFirstBit) +
+                      iOffset;
+    if constexpr (sBytesPerPixelBlock == sizeof(iValue)) {
+      for (; aNbBlocks >= 2; aNbBlocks -= 2) {
+        std::memcpy(aPos, aPatternTab, sizeof(aPatternTab));
+        aPos += sizeof(aPatternTab);
+      }
+    }
+    for (; aNbBlocks > 0; --aNbBlocks) {
+      std::memcpy(aPos, &iValue, sizeof(iValue));
+      aPos += sBytesPerPixelBlock;
     }
   }
 }
 
-void decodeConstantAlphaFrom4Bits(State& ioState,
-                                  std::vector<bool>& ioAlphaBitMap,
-                                  const FullFormat& iFullFormat,
-                                  std::byte* ioOutputTab) {
-  needBits(ioState, 4);
-  std::uint8_t aAlphaValueByte = readBits(ioState, 4);
-  dropBits(ioState, 4);
+// Position of the first block not filled in iBitmap from iPos, or iEndPos
+std::uint32_t findFreeBlock(const BlockBitmap& iBitmap, std::uint32_t iPos,
+                            std::uint32_t iEndPos) {
+  while (iPos < iEndPos) {
+    const std::size_t aWordIndex = iPos / 64;
+    const std::uint64_t aFreeMask =
+        ~iBitmap[aWordIndex] & (~std::uint64_t{0} << (iPos % 64));
+    if (aFreeMask != 0) {
+      return aWordIndex * 64 + std::countr_zero(aFreeMask);
+    }
+    iPos = (aWordIndex + 1) * 64;
+  }
+  return iEndPos;
+}
+
+// Goes over a run of iNbBlocks blocks not filled in ioBitmap from
+// ioPixelBlockPos, then over the filled blocks following it. With iIsFilling,
+// the blocks of the run get iValue at iOffset and are marked as filled, in
+// ioOtherBitmap too when given.
+template <std::uint32_t sBytesPerPixelBlock>
+[[gnu::noinline]] void applyRunSlow(std::uint32_t& ioPixelBlockPos,
+                                    std::uint16_t iNbBlocks, bool iIsFilling,
+                                    std::uint32_t iOffset, std::uint64_t iValue,
+                                    BlockBitmap& ioBitmap,
+                                    BlockBitmap* ioOtherBitmap,
+                                    const FullFormat& iFullFormat,
+                                    std::byte* ioOutputTab) {
+  const std::uint32_t anEndPos = iFullFormat.nbObPixelBlocks;
+  std::uint32_t aPos = ioPixelBlockPos;
+  std::uint32_t aNbBlocksLeft = iNbBlocks;
+
+  while (aNbBlocksLeft > 0 && aPos < anEndPos) {
+    const std::size_t aWordIndex = aPos / 64;
+    const std::uint64_t aFreeMask =
+        ~ioBitmap[aWordIndex] & (~std::uint64_t{0} << (aPos % 64));
+    const std::uint32_t aNbFreeBlocks = std::popcount(aFreeMask);
+
+    std::uint64_t aRunMask = aFreeMask;
+    if (aNbFreeBlocks >= aNbBlocksLeft) {
+      // Dropping the free blocks before the last one of the run
+      std::uint64_t aMask = aFreeMask;
+      for (std::uint32_t i = 1; i < aNbBlocksLeft; ++i) {
+        aMask &= aMask - 1;
+      }
+      const std::uint32_t aLastBit = std::countr_zero(aMask);
+      aRunMask &= (std::uint64_t{2} << aLastBit) - 1;
+      aNbBlocksLeft = 0;
+      aPos = aWordIndex * 64 + aLastBit + 1;
+    } else {
+      aNbBlocksLeft -= aNbFreeBlocks;
+      aPos = (aWordIndex + 1) * 64;
+    }
+
+    if (iIsFilling && aRunMask != 0) {
+      fillBlocks<sBytesPerPixelBlock>(ioOutputTab, aWordIndex * 64, aRunMask,
+                                      iOffset, iValue);
+      ioBitmap[aWordIndex] |= aRunMask;
+      if (ioOtherBitmap != nullptr) {
+        (*ioOtherBitmap)[aWordIndex] |= aRunMask;
+      }
+    }
+  }
+
+  ioPixelBlockPos = findFreeBlock(ioBitmap, aPos, anEndPos);
+}
+
+// Same as applyRunSlow, the common runs of free blocks starting at
+// ioPixelBlockPos and following each other in a word being handled inline
+template <std::uint32_t sBytesPerPixelBlock>
+[[gnu::always_inline]] inline void applyRun(
+    std::uint32_t& ioPixelBlockPos, std::uint16_t iNbBlocks, bool iIsFilling,
+    std::uint32_t iOffset, std::uint64_t iValue, BlockBitmap& ioBitmap,
+    BlockBitmap* ioOtherBitmap, const FullFormat& iFullFormat,
+    std::byte* ioOutputTab) {
+  const std::size_t aWordIndex = ioPixelBlockPos / 64;
+  const std::uint32_t aBit = ioPixelBlockPos % 64;
+  // Free blocks from ioPixelBlockPos, the first one in bit 0
+  const std::uint64_t aFreeMask = ~ioBitmap[aWordIndex] >> aBit;
+  const std::uint64_t aRunMask = (std::uint64_t{1} << iNbBlocks) - 1;
+
+  if (iNbBlocks == 0 || aBit + iNbBlocks > 64 ||
+      (aFreeMask & aRunMask) != aRunMask) [[unlikely]] {
+    applyRunSlow<sBytesPerPixelBlock>(ioPixelBlockPos, iNbBlocks, iIsFilling,
+                                      iOffset, iValue, ioBitmap, ioOtherBitmap,
+                                      iFullFormat, ioOutputTab);
+    return;
+  }
+
+  if (iIsFilling) {
+    fillBlocks<sBytesPerPixelBlock>(ioOutputTab, ioPixelBlockPos, aRunMask,
+                                    iOffset, iValue);
+    ioBitmap[aWordIndex] |= aRunMask << aBit;
+    if (ioOtherBitmap != nullptr) {
+      (*ioOtherBitmap)[aWordIndex] |= aRunMask << aBit;
+    }
+  }
+
+  const std::uint64_t aNextFreeMask = aFreeMask >> iNbBlocks;
+  ioPixelBlockPos =
+      aNextFreeMask != 0
+          ? ioPixelBlockPos + iNbBlocks + std::countr_zero(aNextFreeMask)
+          : findFreeBlock(ioBitmap, (aWordIndex + 1) * 64,
+                          iFullFormat.nbObPixelBlocks);
+}
+
+// The passes return the position in the stream, in bits, of the last code
+// they read.
+
+template <Format sFormat>
+std::size_t decodeWhiteColor(TextureBitArray& ioInputBitArray,
+                             BlockBitmap& ioAlphaBitMap,
+                             BlockBitmap& ioColorBitMap,
+                             const FullFormat& iFullFormat,
+                             std::byte* ioOutputTab) {
+  constexpr FormatLayout sLayout = makeFormatLayout(sFormat);
+
+  uint32_t aPixelBlockPos = 0;
+  std::size_t aCodePos = ioInputBitArray.nbConsumedBits();
+
+  while (aPixelBlockPos < iFullFormat.nbObPixelBlocks) {
+    // Reading next code
+    ioInputBitArray.refill();
+    aCodePos = ioInputBitArray.nbConsumedBits();
+    std::uint16_t aCode = 0;
+    sHuffmanTreeDict.readCode(ioInputBitArray, aCode);
+
+    std::uint32_t aValue = ioInputBitArray.peek<1>();
+    ioInputBitArray.consume(1);
+
+    applyRun<sLayout.bytesPerPixelBlock>(
+        aPixelBlockPos, aCode, aValue, 0, 0xFFFFFFFFFFFFFFFE, ioColorBitMap,
+        &ioAlphaBitMap, iFullFormat, ioOutputTab);
+  }
+
+  return aCodePos;
+}
+
+template <Format sFormat>
+std::size_t decodeConstantAlphaFrom4Bits(TextureBitArray& ioInputBitArray,
+                                         BlockBitmap& ioAlphaBitMap,
+                                         const FullFormat& iFullFormat,
+                                         std::byte* ioOutputTab) {
+  constexpr FormatLayout sLayout = makeFormatLayout(sFormat);
+
+  std::uint8_t aAlphaValueByte;
+  ioInputBitArray.read<4>(aAlphaValueByte);
+  ioInputBitArray.drop<4>();
 
   std::uint32_t aPixelBlockPos = 0;
 
@@ -194,96 +421,84 @@ void decodeConstantAlphaFrom4Bits(State& ioState,
   std::uint64_t aIntermediateDWord =
       aIntermediateWord | (aIntermediateWord << 16);
   std::uint64_t aAlphaValue = aIntermediateDWord | (aIntermediateDWord << 32);
-  std::uint64_t zero = 0;
+  std::size_t aCodePos = ioInputBitArray.nbConsumedBits();
 
   while (aPixelBlockPos < iFullFormat.nbObPixelBlocks) {
     // Reading next code
+    ioInputBitArray.refill();
+    aCodePos = ioInputBitArray.nbConsumedBits();
     std::uint16_t aCode = 0;
-    readCode(sHuffmanTreeDict, ioState, aCode);
+    sHuffmanTreeDict.readCode(ioInputBitArray, aCode);
 
-    needBits(ioState, 2);
-    std::uint32_t aValue = readBits(ioState, 1);
-    dropBits(ioState, 1);
+    std::uint32_t aValue = ioInputBitArray.peek<1>();
+    ioInputBitArray.consume(1);
 
-    std::uint8_t isNotNull = readBits(ioState, 1);
+    std::uint8_t isNotNull = ioInputBitArray.peek<1>();
     if (aValue) {
-      dropBits(ioState, 1);
-    }
-    while (aCode > 0) {
-      if (!ioAlphaBitMap[aPixelBlockPos]) {
-        if (aValue) {
-          std::memcpy(
-              &(ioOutputTab[iFullFormat.bytesPerPixelBlock * (aPixelBlockPos)]),
-              isNotNull ? &aAlphaValue : &zero, iFullFormat.bytesPerComponent);
-          ioAlphaBitMap[aPixelBlockPos] = true;
-        }
-        --aCode;
-      }
-      ++aPixelBlockPos;
-    }
-
-    while (aPixelBlockPos < iFullFormat.nbObPixelBlocks &&
-           ioAlphaBitMap[aPixelBlockPos]) {
-      ++aPixelBlockPos;
+      ioInputBitArray.consume(1);
     }
+    applyRun<sLayout.bytesPerPixelBlock>(
+        aPixelBlockPos, aCode, aValue, 0, isNotNull ? aAlphaValue : 0,
+        ioAlphaBitMap, nullptr, iFullFormat, ioOutputTab);
   }
+
+  return aCodePos;
 }
 
-void decodeConstantAlphaFrom8Bits(State& ioState,
-                                  std::vector<bool>& ioAlphaBitMap,
-                                  const FullFormat& iFullFormat,
-                                  std::byte* ioOutputTab) {
-  needBits(ioState, 8);
-  std::uint8_t aAlphaValueByte = readBits(ioState, 8);
-  dropBits(ioState, 8);
+template <Format sFormat>
+std::size_t decodeConstantAlphaFrom8Bits(TextureBitArray& ioInputBitArray,
+                                         BlockBitmap& ioAlphaBitMap,
+                                         const FullFormat& iFullFormat,
+                                         std::byte* ioOutputTab) {
+  constexpr FormatLayout sLayout = makeFormatLayout(sFormat);
+
+  std::uint8_t aAlphaValueByte;
+  ioInputBitArray.read<8>(aAlphaValueByte);
+  ioInputBitArray.drop<8>();
 
   std::uint32_t aPixelBlockPos = 0;
 
   std::uint64_t aAlphaValue = aAlphaValueByte | (aAlphaValueByte << 8);
-  std::uint64_t zero = 0;
+  std::size_t aCodePos = ioInputBitArray.nbConsumedBits();
 
   while (aPixelBlockPos < iFullFormat.nbObPixelBlocks) {
     // Reading next code
+    ioInputBitArray.refill();
+    aCodePos = ioInputBitArray.nbConsumedBits();
     std::uint16_t aCode = 0;
-    readCode(sHuffmanTreeDict, ioState, aCode);
+    sHuffmanTreeDict.readCode(ioInputBitArray, aCode);
 
-    needBits(ioState, 2);
-    std::uint32_t aValue = readBits(ioState, 1);
-    dropBits(ioState, 1);
+    std::uint32_t aValue = ioInputBitArray.peek<1>();
+    ioInputBitArray.consume(1);
 
-    std::uint8_t isNotNull = readBits(ioState, 1);
+    std::uint8_t isNotNull = ioInputBitArray.peek<1>();
     if (aValue) {
-      dropBits(ioState, 1);
-    }
-    while (aCode > 0) {
-      if (!ioAlphaBitMap[aPixelBlockPos]) {
-        if (aValue) {
-          memcpy(
-              &(ioOutputTab[iFullFormat.bytesPerPixelBlock * (aPixelBlockPos)]),
-              isNotNull ? &aAlphaValue : &zero, iFullFormat.bytesPerComponent);
-          ioAlphaBitMap[aPixelBlockPos] = true;
-        }
-        --aCode;
-      }
-      ++aPixelBlockPos;
-    }
-
-    while (aPixelBlockPos < iFullFormat.nbObPixelBlocks &&
-           ioAlphaBitMap[aPixelBlockPos]) {
-      ++aPixelBlockPos;
+      ioInputBitArray.consume(1);
     }
+    applyRun<sLayout.bytesPerPixelBlock>(
+        aPixelBlockPos, aCode, aValue, 0, isNotNull ? aAlphaValue : 0,
+        ioAlphaBitMap, nullptr, iFullFormat, ioOutputTab);
   }
+
+  return aCodePos;
 }
 
-void decodePlainColor(State& ioState, std::vector<bool>& ioColorBitMap,
-                      const FullFormat& iFullFormat, std::byte* ioOutputTab) {
-  needBits(ioState, 24);
-  std::uint16_t aBlue = readBits(ioState, 8);
-  dropBits(ioState, 8);
-  std::uint16_t aGreen = readBits(ioState, 8);
-  dropBits(ioState, 8);
-  std::uint16_t aRed = readBits(ioState, 8);
-  dropBits(ioState, 8);
+template <Format sFormat>
+std::size_t decodePlainColor(TextureBitArray& ioInputBitArray,
+                             BlockBitmap& ioColorBitMap,
+                             const FullFormat& iFullFormat,
+                             std::byte* ioOutputTab) {
+  constexpr FormatLayout sLayout = makeFormatLayout(sFormat);
+
+  std::uint16_t aBlue;
+  ioInputBitArray.read<8>(aBlue);
+  ioInputBitArray.drop<8>();
+  std::uint16_t aGreen;
+  ioInputBitArray.read<8>(aGreen);
+  ioInputBitArray.drop<8>();
+  std::uint16_t aRed;
+  ioInputBitArray.read<8>(aRed);
+  ioInputBitArray.drop<8>();
 
   // TEMP
 
@@ -405,7 +620,7 @@ void decodePlainColor(State& ioState, std::vector<bool>& ioColorBitMap,
   }
 
   bool aDxt1SpecialCase =
-      (iFullFormat.format.flags & FF_DEDUCEDALPHACOMP) &&
+      (sFormat.flags & FF_DEDUCEDALPHACOMP) &&
       (aTempValue1 == 5 || aTempValue1 == 6 || aTempValue2 != 0);
 
   if (aTempValue2 > 0 && !aDxt1SpecialCase) {
@@ -449,151 +664,203 @@ void decodePlainColor(State& ioState, std::vector<bool>& ioColorBitMap,
   aTempValue = aTempValue | (aTempValue << 16);
   std::uint64_t aFinalValue =
       aValueColor1 | (aValueColor2 << 16) | (aTempValue << 32);
+  constexpr std::uint32_t aComponentOffset =
+      sLayout.hasTwoComponents ? sLayout.bytesPerComponent : 0;
 
   std::uint32_t aPixelBlockPos = 0;
+  std::size_t aCodePos = ioInputBitArray.nbConsumedBits();
 
   while (aPixelBlockPos < iFullFormat.nbObPixelBlocks) {
     // Reading next code
+    ioInputBitArray.refill();
+    aCodePos = ioInputBitArray.nbConsumedBits();
     std::uint16_t aCode = 0;
-    readCode(sHuffmanTreeDict, ioState, aCode);
-
-    needBits(ioState, 1);
-    std::uint32_t aValue = readBits(ioState, 1);
-    dropBits(ioState, 1);
-
-    while (aCode > 0) {
-      if (!ioColorBitMap[aPixelBlockPos]) {
-        if (aValue) {
-          std::uint32_t aOffset =
-              iFullFormat.bytesPerPixelBlock * (aPixelBlockPos) +
-              (iFullFormat.hasTwoComponents ? iFullFormat.bytesPerComponent
-                                            : 0);
-          std::memcpy(&(ioOutputTab[aOffset]), &aFinalValue,
-                      iFullFormat.bytesPerComponent);
-          ioColorBitMap[aPixelBlockPos] = true;
-        }
-        --aCode;
-      }
-      ++aPixelBlockPos;
-    }
+    sHuffmanTreeDict.readCode(ioInputBitArray, aCode);
 
-    while (aPixelBlockPos < iFullFormat.nbObPixelBlocks &&
-           ioColorBitMap[aPixelBlockPos]) {
-      ++aPixelBlockPos;
-    }
+    std::uint32_t aValue = ioInputBitArray.peek<1>();
+    ioInputBitArray.consume(1);
+
+    applyRun<sLayout.bytesPerPixelBlock>(
+        aPixelBlockPos, aCode, aValue, aComponentOffset, aFinalValue,
+        ioColorBitMap, nullptr, iFullFormat, ioOutputTab);
   }
-}
 
-void inflateData(State& iState, const FullFormat& iFullFormat,
-                 std::uint32_t ioOutputSize, std::byte* ioOutputTab) {
-  // Bitmaps
-  std::vector<bool> aColorBitmap;
-  std::vector<bool> aAlphaBitmap;
+  return aCodePos;
+}
 
-  std::uint32_t aChunkStartPosition = iState.inputPos;
+// Position in the input, in words, of the first uncompressed word, iEndPos
+// bits of the stream being compressed and iCodePos the position of the last
+// code. The original decoder pulled one word whenever it was short of bits,
+// 32 of them to read a code, and went back one word when a whole one was left
+// after the last code. The uncompressed words thus start after the word of
+// the last bit, on the skipped word following it if any, unless the last code
+// started past the first bit of that word.
+std::size_t findUncompressedWordPos(std::size_t iCodePos, std::size_t iEndPos) {
+  const std::size_t anEndWordPos = (iEndPos + 31) / 32;
+  if ((iCodePos + 31) / 32 == anEndWordPos) {
+    return TextureBitArray::bufferWordPos(anEndWordPos);
+  }
+  return TextureBitArray::bufferWordPos(anEndWordPos - 1) + 1;
+}
 
-  iState.inputPos = aChunkStartPosition;
+template <Format sFormat>
+Result<void> inflateData(
+    std::span<const std::span<const std::byte>> iInputFragmentTab,
+    bool iVerifiesChecksums, const FullFormat& iFullFormat,
+    std::byte* ioOutputTab, utils::Xxh64* ipHash) {
+  constexpr FormatLayout sLayout = makeFormatLayout(sFormat);
+  const std::size_t anOutputSize =
+      std::size_t{sLayout.bytesPerPixelBlock} * iFullFormat.nbObPixelBlocks;
+
+  // With ipHash, the output is hashed right behind the last pass writing to
+  // it, while still in cache
+  std::size_t aHashedSize = 0;
+  const auto hashUpTo = [&](std::size_t iSize) {
+    if (ipHash != nullptr && iSize > aHashedSize) {
+      ipHash->update({ioOutputTab + aHashedSize, iSize - aHashedSize});
+      aHashedSize = iSize;
+    }
+  };
 
-  iState.head = 0;
-  iState.bits = 0;
-  iState.buffer = 0;
+  TextureBitArray anInputBitArray(iInputFragmentTab, iVerifiesChecksums);
 
   // Getting size of compressed data
-  needBits(iState, 32);
-  std::uint32_t aDataSize = readBits(iState, 32);
-  dropBits(iState, 32);
+  std::uint32_t aDataSize;
+  anInputBitArray.read(aDataSize);
+  anInputBitArray.drop<std::uint32_t>();
 
-  // Compression Flags
-  needBits(iState, 32);
-  std::uint32_t aCompressionFlags = readBits(iState, 32);
-  dropBits(iState, 32);
+  // Compression Flags, read like a code
+  std::size_t aCodePos = anInputBitArray.nbConsumedBits();
+  std::uint32_t aCompressionFlags;
+  anInputBitArray.read(aCompressionFlags);
+  anInputBitArray.drop<std::uint32_t>();
 
-  aColorBitmap.assign(iFullFormat.nbObPixelBlocks, false);
-  aAlphaBitmap.assign(iFullFormat.nbObPixelBlocks, false);
+  // Bitmaps
+  BlockBitmap aColorBitmap(iFullFormat.nbObPixelBlocks);
+  BlockBitmap aAlphaBitmap(iFullFormat.nbObPixelBlocks);
 
   if (aCompressionFlags & CF_DECODE_WHITE_COLOR) {
-    decodeWhiteColor(iState, aAlphaBitmap, aColorBitmap, iFullFormat,
-                     ioOutputTab);
+    aCodePos = decodeWhiteColor<sFormat>(anInputBitArray, aAlphaBitmap,
+                                         aColorBitmap, iFullFormat,
+                                         ioOutputTab);
   }
 
   if (aCompressionFlags & CF_DECODE_CONSTANT_ALPHA_FROM4BITS) {
-    decodeConstantAlphaFrom4Bits(iState, aAlphaBitmap, iFullFormat,
-                                 ioOutputTab);
+    aCodePos = decodeConstantAlphaFrom4Bits<sFormat>(
+        anInputBitArray, aAlphaBitmap, iFullFormat, ioOutputTab);
   }
 
   if (aCompressionFlags & CF_DECODE_CONSTANT_ALPHA_FROM8BITS) {
-    decodeConstantAlphaFrom8Bits(iState, aAlphaBitmap, iFullFormat,
-                                 ioOutputTab);
+    aCodePos = decodeConstantAlphaFrom8Bits<sFormat>(
+        anInputBitArray, aAlphaBitmap, iFullFormat, ioOutputTab);
   }
 
   if (aCompressionFlags & CF_DECODE_PLAIN_COLOR) {
-    decodePlainColor(iState, aColorBitmap, iFullFormat, ioOutputTab);
+    aCodePos = decodePlainColor<sFormat>(anInputBitArray, aColorBitmap,
+                                         iFullFormat, ioOutputTab);
   }
 
-  std::uint32_t aLoopIndex;
-
-  if (iState.bits >= 32) {
-    --iState.inputPos;
+  if (anInputBitArray.hasChecksumMismatch()) {
+    return std::unexpected{Error::kChecksumMismatch};
+  }
+  if (anInputBitArray.readPastEnd()) {
+    hashUpTo(anOutputSize);
+    return {};
   }
 
-  if ((((iFullFormat.format.flags) & FF_ALPHA) &&
-       !((iFullFormat.format.flags) & FF_DEDUCEDALPHACOMP)) ||
-      (iFullFormat.format.flags) & FF_BICOLORCOMP) {
-    for (aLoopIndex = 0;
-         aLoopIndex < aAlphaBitmap.size() && iState.inputPos < iState.inputSize;
-         ++aLoopIndex) {
-      if (!aAlphaBitmap[aLoopIndex]) {
-        (*std::bit_cast<std::uint32_t*>(
-            &(ioOutputTab[iFullFormat.bytesPerPixelBlock * aLoopIndex]))) =
-            iState.input[iState.inputPos];
-        ++iState.inputPos;
-        if (iFullFormat.bytesPerComponent > 4) {
-          (*std::bit_cast<std::uint32_t*>(&(
-              ioOutputTab[iFullFormat.bytesPerPixelBlock * aLoopIndex + 4]))) =
-              iState.input[iState.inputPos];
-          ++iState.inputPos;
+  // The uncompressed words, the skipped ones included
+  const std::size_t aWordPos =
+      findUncompressedWordPos(aCodePos, anInputBitArray.nbConsumedBits());
+  std::size_t aNbWords = 0;
+  for (std::span<const std::byte> aFragment : iInputFragmentTab) {
+    aNbWords += aFragment.size();
+  }
+  aNbWords /= sizeof(std::uint32_t);
+  WordReader aWordReader(iInputFragmentTab, aWordPos);
+  // The loops only check for the end of the input once per block, the words
+  // past it read as 0
+  std::size_t aNbWordsLeft = aNbWords - std::min(aWordPos, aNbWords);
+  const auto readWord = [&aWordReader, &aNbWordsLeft]() -> std::uint32_t {
+    if (aNbWordsLeft == 0) {
+      return 0;
+    }
+    --aNbWordsLeft;
+    return aWordReader.read();
+  };
+  // Goes over the blocks not filled in iBitmap, as long as words are left.
+  // The last pass hashes the blocks behind it.
+  constexpr std::size_t sBytesPerBitmapWord = 64 * sLayout.bytesPerPixelBlock;
+  const auto forEachFreeBlock = [&](const BlockBitmap& iBitmap,
+                                    bool iIsLastPass, auto&& iFunction) {
+    for (std::size_t aWordIndex = 0; aWordIndex < iBitmap.nbWords();
+         ++aWordIndex) {
+      for (std::uint64_t aFreeMask = ~iBitmap[aWordIndex]; aFreeMask != 0;
+           aFreeMask &= aFreeMask - 1) {
+        if (aNbWordsLeft == 0) {
+          return;
         }
+        iFunction(aWordIndex * 64 + std::countr_zero(aFreeMask));
+      }
+      if (iIsLastPass) {
+        hashUpTo(
+            std::min(anOutputSize, (aWordIndex + 1) * sBytesPerBitmapWord));
       }
     }
+  };
+
+  constexpr bool sHasColorWords =
+      sFormat.flags & FF_COLOR || sFormat.flags & FF_BICOLORCOMP;
+
+  if constexpr (((sFormat.flags & FF_ALPHA) &&
+                 !(sFormat.flags & FF_DEDUCEDALPHACOMP)) ||
+                sFormat.flags & FF_BICOLORCOMP) {
+    forEachFreeBlock(aAlphaBitmap, !sHasColorWords, [&](std::size_t iBlockPos) {
+      (*std::bit_cast<std::uint32_t*>(
+          &(ioOutputTab[sLayout.bytesPerPixelBlock * iBlockPos]))) =
+          readWord();
+      if constexpr (sLayout.bytesPerComponent > 4) {
+        (*std::bit_cast<std::uint32_t*>(
+            &(ioOutputTab[sLayout.bytesPerPixelBlock * iBlockPos + 4]))) =
+            readWord();
+      }
+    });
   }
 
-  if ((iFullFormat.format.flags) & FF_COLOR ||
-      (iFullFormat.format.flags) & FF_BICOLORCOMP) {
-    for (aLoopIndex = 0;
-         aLoopIndex < aColorBitmap.size() && iState.inputPos < iState.inputSize;
-         ++aLoopIndex) {
-      if (!aColorBitmap[aLoopIndex]) {
+  if constexpr (sHasColorWords) {
+    constexpr bool sHasTwoColorPasses = sLayout.bytesPerComponent > 4;
+    forEachFreeBlock(aColorBitmap, !sHasTwoColorPasses,
+                     [&](std::size_t iBlockPos) {
+      std::uint32_t aOffset =
+          sLayout.bytesPerPixelBlock * iBlockPos +
+          (sLayout.hasTwoComponents ? sLayout.bytesPerComponent : 0);
+      (*std::bit_cast<std::uint32_t*>(&(ioOutputTab[aOffset]))) = readWord();
+    });
+    if constexpr (sHasTwoColorPasses) {
+      forEachFreeBlock(aColorBitmap, true, [&](std::size_t iBlockPos) {
         std::uint32_t aOffset =
-            iFullFormat.bytesPerPixelBlock * aLoopIndex +
-            (iFullFormat.hasTwoComponents ? iFullFormat.bytesPerComponent : 0);
+            sLayout.bytesPerPixelBlock * iBlockPos + 4 +
+            (sLayout.hasTwoComponents ? sLayout.bytesPerComponent : 0);
         (*std::bit_cast<std::uint32_t*>(&(ioOutputTab[aOffset]))) =
-            iState.input[iState.inputPos];
-        ++iState.inputPos;
-      }
-    }
-    if (iFullFormat.bytesPerComponent > 4) {
-      for (aLoopIndex = 0; aLoopIndex < aColorBitmap.size() &&
-                           iState.inputPos < iState.inputSize;
-           ++aLoopIndex) {
-        if (!aColorBitmap[aLoopIndex]) {
-          std::uint32_t aOffset =
-              iFullFormat.bytesPerPixelBlock * aLoopIndex + 4 +
-              (iFullFormat.hasTwoComponents ? iFullFormat.bytesPerComponent
-                                            : 0);
-          (*std::bit_cast<std::uint32_t*>(&(ioOutputTab[aOffset]))) =
-              iState.input[iState.inputPos];
-          ++iState.inputPos;
-        }
-      }
+            readWord();
+      });
     }
   }
+
+  // The blocks left when the words ran out
+  hashUpTo(anOutputSize);
+  return {};
 }
-}  // namespace texture
 
 Result<std::uint32_t> inflateTextureBlockBuffer(
     std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
-    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
-  if (iInputTab.empty()) {
+    std::span<const std::span<const std::byte>> iInputFragmentTab,
+    std::span<std::byte> ioOutputTab, bool iVerifiesChecksums,
+    utils::Xxh64* ipHash) {
+  std::size_t anInputSize = 0;
+  for (std::span<const std::byte> aFragment : iInputFragmentTab) {
+    anInputSize += aFragment.size();
+  }
+  if (anInputSize == 0) {
     return std::unexpected{Error::kInputBufferIsEmpty};
   }
 
@@ -601,11 +868,6 @@ Result<std::uint32_t> inflateTextureBlockBuffer(
     return std::unexpected{Error::kOutputBufferIsEmpty};
   }
 
-  if (!texture::sStaticValuesInitialized) {
-    texture::initializeStaticValues();
-    texture::sStaticValuesInitialized = true;
-  }
-
   // Initialize format
   texture::FullFormat aFullFormat;
 
@@ -615,37 +877,68 @@ Result<std::uint32_t> inflateTextureBlockBuffer(
 
   aFullFormat.nbObPixelBlocks =
       ((aFullFormat.width + 3) / 4) * ((aFullFormat.height + 3) / 4);
-  aFullFormat.bytesPerPixelBlock =
-      (aFullFormat.format.pixelSizeInBits * 4 * 4) / 8;
-  aFullFormat.hasTwoComponents =
-      ((aFullFormat.format.flags &
-        (texture::FF_PLAINCOMP | texture::FF_COLOR | texture::FF_ALPHA)) ==
-       (texture::FF_PLAINCOMP | texture::FF_COLOR | texture::FF_ALPHA)) ||
-      (aFullFormat.format.flags & texture::FF_BICOLORCOMP);
-
-  aFullFormat.bytesPerComponent =
-      aFullFormat.bytesPerPixelBlock / (aFullFormat.hasTwoComponents ? 2 : 1);
-
-  // Initialize state
-  State aState;
-  aState.input = std::bit_cast<const std::uint32_t*>(iInputTab.data());
-  aState.inputSize = iInputTab.size() / 4;
-  aState.inputPos = 0;
-
-  aState.head = 0;
-  aState.bits = 0;
-  aState.buffer = 0;
-
-  aState.isEmpty = false;
 
   std::uint32_t anOutputSize =
-      aFullFormat.bytesPerPixelBlock * aFullFormat.nbObPixelBlocks;
+      texture::makeFormatLayout(aFullFormat.format).bytesPerPixelBlock *
+      aFullFormat.nbObPixelBlocks;
   if (ioOutputTab.size() < anOutputSize) {
     return std::unexpected{Error::kOutputBufferTooSmall};
   }
 
-  texture::inflateData(aState, aFullFormat, anOutputSize, ioOutputTab.data());
+  Result<void> aResult = utils::callKernel([&] {
+    return texture::visitFormat(
+        iFormatFourCc, [&]<texture::Format sFormat> {
+          return texture::inflateData<sFormat>(
+              iInputFragmentTab, iVerifiesChecksums, aFullFormat,
+              ioOutputTab.data(), ipHash);
+        });
+  });
+  if (!aResult) {
+    return std::unexpected{aResult.error()};
+  }
   return anOutputSize;
 }
+}  // namespace texture
+
+Result<std::uint32_t> inflateTextureBlockBuffer(
+    std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  const std::span<const std::byte> anInputFragmentArray[] = {iInputTab};
+  return inflateTextureBlockBuffer(iWidth, iHeight, iFormatFourCc,
+                                   anInputFragmentArray, ioOutputTab);
+}
+
+Result<std::uint32_t> inflateTextureBlockBuffer(
+    std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
+    std::span<const std::span<const std::byte>> iInputFragmentTab,
+    std::span<std::byte> ioOutputTab) {
+  return texture::inflateTextureBlockBuffer(
+      iWidth, iHeight, iFormatFourCc, iInputFragmentTab, ioOutputTab, false,
+      nullptr);
+}
+
+Result<std::uint32_t> inflateTextureBlockBufferVerified(
+    std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  const std::span<const std::byte> anInputFragmentArray[] = {iInputTab};
+  return texture::inflateTextureBlockBuffer(iWidth, iHeight, iFormatFourCc,
+                                            anInputFragmentArray, ioOutputTab,
+                                            true, nullptr);
+}
+
+Result<HashedOutput> inflateTextureBlockBufferWithHash(
+    std::uint16_t iWidth, std::uint16_t iHeight, std::uint32_t iFormatFourCc,
+    std::span<const std::byte> iInputTab, std::span<std::byte> ioOutputTab) {
+  const std::span<const std::byte> anInputFragmentArray[] = {iInputTab};
+  utils::Xxh64 aHash;
+  Result<std::uint32_t> anOutputSize = texture::inflateTextureBlockBuffer(
+      iWidth, iHeight, iFormatFourCc, anInputFragmentArray, ioOutputTab, false,
+      &aHash);
+  if (!anOutputSize) {
+    return std::unexpected{anOutputSize.error()};
+  }
+
+  return HashedOutput{*anOutputSize, aHash.digest()};
+}
 
 }  // namespace gw2::compression
@@ -0,0 +1,13 @@
+#include "compression/OutputHash.hpp"
+
+#include "Xxh64.hpp"
+
+namespace gw2::compression {
+
+std::uint64_t hashOutput(std::span<const std::byte> iBufferTab) {
+  utils::Xxh64 aHash;
+  aHash.update(iBufferTab);
+  return aHash.digest();
+}
+
+}  // namespace gw2::compression
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace gw2::utils {
+
+// XXH64 hash of the bytes given to update() one part after the other, equal to
+// the hash of all of them at once
+class Xxh64 {
+ public:
+  explicit Xxh64(std::uint64_t iSeed = 0)
+      : _accArray{iSeed + sPrime1 + sPrime2, iSeed + sPrime2, iSeed,
+                  iSeed - sPrime1},
+        _seed(iSeed) {}
+
+  void update(std::span<const std::byte> iBytes) {
+    _totalSize += iBytes.size();
+
+    // Completing the pending stripe
+    if (_nbPendingBytes != 0) {
+      const std::size_t aSize =
+          std::min(iBytes.size(), sStripeSize - _nbPendingBytes);
+      std::memcpy(&_pendingStripe[_nbPendingBytes], iBytes.data(), aSize);
+      _nbPendingBytes += aSize;
+      iBytes = iBytes.subspan(aSize);
+      if (_nbPendingBytes < sStripeSize) {
+        return;
+      }
+      consumeStripe(_pendingStripe.data());
+      _nbPendingBytes = 0;
+    }
+
+    while (iBytes.size() >= sStripeSize) {
+      consumeStripe(iBytes.data());
+      iBytes = iBytes.subspan(sStripeSize);
+    }
+
+    std::memcpy(_pendingStripe.data(), iBytes.data(), iBytes.size());
+    _nbPendingBytes = iBytes.size();
+  }
+
+  std::uint64_t digest() const {
+    std::uint64_t aHash;
+    if (_totalSize >= sStripeSize) {
+      aHash = std::rotl(_accArray[0], 1) + std::rotl(_accArray[1], 7) +
+              std::rotl(_accArray[2], 12) + std::rotl(_accArray[3], 18);
+      for (std::uint64_t anAcc : _accArray) {
+        aHash = mergeRound(aHash, anAcc);
+      }
+    } else {
+      aHash = _seed + sPrime5;
+    }
+    aHash += _totalSize;
+
+    const std::byte* pBytes = _pendingStripe.data();
+    std::size_t aNbBytes = _nbPendingBytes;
+    for (; aNbBytes >= 8; aNbBytes -= 8, pBytes += 8) {
+      aHash ^= round(0, read<std::uint64_t>(pBytes));
+      aHash = std::rotl(aHash, 27) * sPrime1 + sPrime4;
+    }
+    if (aNbBytes >= 4) {
+      aHash ^= read<std::uint32_t>(pBytes) * sPrime1;
+      aHash = std::rotl(aHash, 23) * sPrime2 + sPrime3;
+      aNbBytes -= 4;
+      pBytes += 4;
+    }
+    for (; aNbBytes != 0; --aNbBytes, ++pBytes) {
+      aHash ^= std::to_integer<std::uint64_t>(*pBytes) * sPrime5;
+      aHash = std::rotl(aHash, 11) * sPrime1;
+    }
+
+    aHash ^= aHash >> 33;
+    aHash *= sPrime2;
+    aHash ^= aHash >> 29;
+    aHash *= sPrime3;
+    aHash ^= aHash >> 32;
+    return aHash;
+  }
+
+ private:
+  static constexpr std::uint64_t sPrime1 = 0x9e3779b185ebca87;
+  static constexpr std::uint64_t sPrime2 = 0xc2b2ae3d27d4eb4f;
+  static constexpr std::uint64_t sPrime3 = 0x165667b19e3779f9;
+  static constexpr std::uint64_t sPrime4 = 0x85ebca77c2b2ae63;
+  static constexpr std::uint64_t sPrime5 = 0x27d4eb2f165667c5;
+
+  // Bytes hashed by each of the 4 accumulators in turn
+  static constexpr std::size_t sStripeSize = 32;
+
+  template <typename IntType>
+  static IntType read(const std::byte* ipBytes) {
+    IntType aValue;
+    std::memcpy(&aValue, ipBytes, sizeof(aValue));
+    return aValue;
+  }
+
+  static std::uint64_t round(std::uint64_t iAcc, std::uint64_t iValue) {
+    iAcc += iValue * sPrime2;
+    return std::rotl(iAcc, 31) * sPrime1;
+  }
+
+  static std::uint64_t mergeRound(std::uint64_t iHash, std::uint64_t iAcc) {
+    iHash ^= round(0, iAcc);
+    return iHash * sPrime1 + sPrime4;
+  }
+
+  void consumeStripe(const std::byte* ipStripe) {
+    for (std::size_t anIndex = 0; anIndex < _accArray.size(); ++anIndex) {
+      _accArray[anIndex] = round(
+          _accArray[anIndex], read<std::uint64_t>(&ipStripe[anIndex * 8]));
+    }
+  }
+
+  std::array<std::uint64_t, 4> _accArray;
+  std::uint64_t _seed;
+  std::uint64_t _totalSize{0};
+
+  // Bytes not making a whole stripe yet
+  std::array<std::byte, sStripeSize> _pendingStripe;
+  std::size_t _nbPendingBytes{0};
+};
+
+}  // namespace gw2::utils